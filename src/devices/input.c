@@ -2,15 +2,19 @@
 #include <debug.h>
 #include "devices/intq.h"
 #include "devices/serial.h"
+#ifdef USERPROG
+#include "userprog/poll.h"
+#endif
 
 /* Stores keys from the keyboard and serial port. */
 static struct intq buffer;
+static uint8_t buffer_space[INTQ_BUFSIZE];
 
 /* Initializes the input buffer. */
 void
 input_init (void) 
 {
-  intq_init (&buffer);
+  intq_init (&buffer, buffer_space, sizeof buffer_space);
 }
 
 /* Adds a key to the input buffer.
@@ -23,6 +27,9 @@ input_putc (uint8_t key)
 
   intq_putc (&buffer, key);
   serial_notify ();
+#ifdef USERPROG
+  poll_wake ();
+#endif
 }
 
 /* Retrieves a key from the input buffer.
@@ -41,6 +48,16 @@ input_getc (void)
   return key;
 }
 
+/* Returns true if the input buffer is empty,
+   false otherwise.
+   Interrupts must be off. */
+bool
+input_empty (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  return intq_empty (&buffer);
+}
+
 /* Returns true if the input buffer is full,
    false otherwise.
    Interrupts must be off. */
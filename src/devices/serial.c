@@ -33,6 +33,18 @@
 #define MCR_REG (IO_BASE + 4)   /* MODEM Control Register. */
 #define LSR_REG (IO_BASE + 5)   /* Line Status Register (read-only). */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable FIFOs. */
+#define FCR_CLEAR_RX 0x02       /* Clear receive FIFO. */
+#define FCR_CLEAR_TX 0x04       /* Clear transmit FIFO. */
+#define FCR_TRIGGER_1 0x00      /* Receive interrupt at 1 byte. */
+#define FCR_TRIGGER_4 0x40      /* Receive interrupt at 4 bytes. */
+#define FCR_TRIGGER_8 0x80      /* Receive interrupt at 8 bytes. */
+#define FCR_TRIGGER_14 0xc0     /* Receive interrupt at 14 bytes. */
+
+/* Interrupt Identification Register bits. */
+#define IIR_FIFO 0xc0           /* FIFOs enabled (16550A). */
+
 /* Interrupt Enable Register bits. */
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
@@ -46,16 +58,48 @@
 
 /* Line Status Register. */
 #define LSR_DR 0x01             /* Data Ready: received data byte is in RBR. */
-#define LSR_THRE 0x20           /* THR Empty. */
+#define LSR_THRE 0x20           /* THR (and transmit FIFO) Empty. */
+#define LSR_TEMT 0x40           /* Transmitter completely idle. */
+
+/* Depth of the 16550A's transmit FIFO. */
+#define FIFO_SIZE 16
+
+/* Size of the transmit queue, in bytes.  Output up to this size
+   can be queued without waiting for the port.  Can be overridden
+   at build time. */
+#ifndef SERIAL_TXQ_SIZE
+#define SERIAL_TXQ_SIZE 1024
+#endif
+
+/* Receive FIFO trigger level.  With a deeper trigger, bursts of
+   input take fewer interrupts; a lone byte still arrives after
+   the UART's receive timeout, about 4 character times. */
+#ifndef SERIAL_RX_TRIGGER
+#define SERIAL_RX_TRIGGER FCR_TRIGGER_8
+#endif
+
+/* Speed to run the port at once interrupts are set up, in bits
+   per second, as set by the kernel's "-bps" option. */
+int serial_bps = 9600;
 
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
 /* Data to be transmitted. */
 static struct intq txq;
+static uint8_t txq_space[SERIAL_TXQ_SIZE];
+
+/* Bytes the transmitter accepts at once: FIFO_SIZE if the UART
+   has working FIFOs, otherwise 1. */
+static int tx_burst;
+
+/* Bytes that may still be written to THR in polling mode before
+   waiting for THRE again.  Zero whenever unknown. */
+static int poll_room;
 
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
+static void init_fifo (void);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
 
@@ -68,10 +112,10 @@ init_poll (void)
 {
   ASSERT (mode == UNINIT);
   outb (IER_REG, 0);                    /* Turn off all interrupts. */
-  outb (FCR_REG, 0);                    /* Disable FIFO. */
+  init_fifo ();                         /* Enable FIFOs, if any. */
   set_serial (9600);                    /* 9.6 kbps, N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
-  intq_init (&txq);
+  intq_init (&txq, txq_space, sizeof txq_space);
   mode = POLL;
 } 
 
@@ -88,8 +132,15 @@ serial_init_queue (void)
   ASSERT (mode == POLL);
 
   intr_register_ext (0x20 + 4, serial_interrupt, "serial");
-  mode = QUEUE;
   old_level = intr_disable ();
+  if (serial_bps != 9600) 
+    {
+      /* Let the last polled byte go out at the old speed. */
+      while ((inb (LSR_REG) & LSR_TEMT) == 0)
+        continue;
+      set_serial (serial_bps);
+    }
+  mode = QUEUE;
   write_ier ();
   intr_set_level (old_level);
 }
@@ -117,9 +168,12 @@ serial_putc (uint8_t byte)
           /* Interrupts are off and the transmit queue is full.
              If we wanted to wait for the queue to empty,
              we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-          putc_poll (intq_getc (&txq)); 
+             That's impolite, so we'll send characters via
+             polling instead, as many as the FIFO takes at
+             once. */
+          int i;
+          for (i = 0; i < tx_burst && !intq_empty (&txq); i++)
+            putc_poll (intq_getc (&txq)); 
         }
 
       intq_putc (&txq, byte); 
@@ -129,6 +183,53 @@ serial_putc (uint8_t byte)
   intr_set_level (old_level);
 }
 
+/* Sends the N bytes in BUFFER to the serial port.  Like calling
+   serial_putc() for each byte, but interrupts are disabled and
+   the interrupt enable register updated once for the whole
+   buffer instead of once per byte, except that if the transmit
+   queue fills up with interrupts on, we wait for it to drain.
+
+   BUFFER must not be in user memory, since a page fault here
+   would run with interrupts disabled. */
+void
+serial_putbuf (const uint8_t *buffer, size_t n) 
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (mode != QUEUE)
+    {
+      if (mode == UNINIT)
+        init_poll ();
+      while (n-- > 0)
+        putc_poll (*buffer++);
+    }
+  else 
+    {
+      while (n-- > 0) 
+        {
+          if (intq_full (&txq)) 
+            {
+              if (old_level == INTR_OFF) 
+                {
+                  int i;
+                  for (i = 0; i < tx_burst && !intq_empty (&txq); i++)
+                    putc_poll (intq_getc (&txq));
+                }
+              else
+                {
+                  /* Make sure the transmit interrupt is on before
+                     intq_putc() waits for it to make room. */
+                  write_ier ();
+                }
+            }
+          intq_putc (&txq, *buffer++);
+        }
+      write_ier ();
+    }
+
+  intr_set_level (old_level);
+}
+
 /* Flushes anything in the serial buffer out the port in polling
    mode. */
 void
@@ -193,16 +294,40 @@ write_ier (void)
   outb (IER_REG, ier);
 }
 
-/* Polls the serial port until it's ready,
-   and then transmits BYTE. */
+/* Enables the 16550A's FIFOs and sets tx_burst according to
+   whether they turned out to work.  The 8250 and 16450 have no
+   FIFOs, and the original 16550's are unreliable; neither
+   reports FIFOs in IIR. */
+static void
+init_fifo (void) 
+{
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR_RX | FCR_CLEAR_TX | SERIAL_RX_TRIGGER);
+  if ((inb (IIR_REG) & IIR_FIFO) == IIR_FIFO)
+    tx_burst = FIFO_SIZE;
+  else 
+    {
+      outb (FCR_REG, 0);
+      tx_burst = 1;
+    }
+  poll_room = 0;
+}
+
+/* Transmits BYTE, first polling the serial port until it's
+   ready if the transmit FIFO might be full.  Once THRE shows the
+   FIFO empty, tx_burst bytes can be written without polling. */
 static void
 putc_poll (uint8_t byte) 
 {
   ASSERT (intr_get_level () == INTR_OFF);
 
-  while ((inb (LSR_REG) & LSR_THRE) == 0)
-    continue;
+  if (poll_room == 0) 
+    {
+      while ((inb (LSR_REG) & LSR_THRE) == 0)
+        continue;
+      poll_room = tx_burst;
+    }
   outb (THR_REG, byte);
+  poll_room--;
 }
 
 /* Serial interrupt handler. */
@@ -218,10 +343,16 @@ serial_interrupt (struct intr_frame *f UNUSED)
   while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
     input_putc (inb (RBR_REG));
 
-  /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+  /* If the transmit FIFO is empty, refill it with as many bytes
+     as it holds. */
+  if ((inb (LSR_REG) & LSR_THRE) != 0) 
+    {
+      int i;
+
+      for (i = 0; i < tx_burst && !intq_empty (&txq); i++)
+        outb (THR_REG, intq_getc (&txq));
+      poll_room = 0;
+    }
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
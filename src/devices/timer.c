@@ -7,6 +7,10 @@
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#ifdef USERPROG
+#include "userprog/poll.h"
+#include "userprog/shared-page.h"
+#endif
   
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -173,7 +177,10 @@ timer_interrupt (struct intr_frame *args UNUSED)
 {
   ticks++;
   thread_tick ();
-
+#ifdef USERPROG
+  shared_page_tick (ticks);
+  poll_tick (ticks);
+#endif
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
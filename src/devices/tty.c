@@ -0,0 +1,215 @@
+#include "devices/tty.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/input.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+
+/* Line discipline for console input.
+
+   In canonical mode, the default, bytes from the keyboard and
+   serial port are collected into a line buffer, with the editing
+   characters below applied and the result echoed to the console.
+   tty_read() waits for a whole line and returns it in one go,
+   new-line included, or as much of it as fits; the rest is
+   returned by the next call.
+
+     Enter         Ends the line.  Carriage returns are read as
+                   new-lines.
+     Backspace     Erases the last character of the line.
+     Ctrl+U        Erases the whole line.
+     Ctrl+D        Ends the line without a new-line, or, at the
+                   start of a line, makes tty_read() return 0 to
+                   signal end of file.
+
+   In raw mode, tty_read() returns whatever bytes have arrived,
+   waiting only if there are none, without editing or echo.
+
+   Input is cooked by the thread that reads it, so typing ahead
+   is limited by the size of the input queue, and is echoed only
+   once someone reads it. */
+
+/* Control character for letter C. */
+#define CTRL(C) ((C) - 'A' + 1)
+
+/* Longest line, including its new-line. */
+#define LINE_MAX 256
+
+static struct lock tty_lock;    /* Serializes readers and mode changes. */
+static enum tty_mode mode;      /* Current mode. */
+
+/* Line buffer.  Bytes in line[pos, done) are ready to be read;
+   bytes in line[done, len) are the line being edited. */
+static uint8_t line[LINE_MAX];
+static size_t pos, done, len;
+static bool eof;                /* Ctrl+D at start of line, not yet read. */
+
+static int next_byte (bool block);
+static void cook (uint8_t);
+
+/* Initializes the line discipline, in canonical mode. */
+void
+tty_init (void) 
+{
+  lock_init (&tty_lock);
+  mode = TTY_CANONICAL;
+  pos = done = len = 0;
+  eof = false;
+}
+
+/* Reads up to SIZE bytes of console input into BUFFER, as
+   described at the top of this file, and returns the number of
+   bytes read. */
+size_t
+tty_read (void *buffer_, size_t size) 
+{
+  uint8_t *buffer = buffer_;
+  size_t n = 0;
+
+  if (size == 0)
+    return 0;
+
+  lock_acquire (&tty_lock);
+  if (mode == TTY_CANONICAL)
+    {
+      while (pos == done && !eof)
+        cook (next_byte (true));
+    }
+  else if (pos == done) 
+    {
+      /* Nothing left over from canonical mode: wait for one
+         byte, then take what else is there. */
+      int c = next_byte (true);
+      do
+        buffer[n++] = c;
+      while (n < size && (c = next_byte (false)) != -1);
+    }
+
+  if (pos < done) 
+    {
+      n = done - pos < size ? done - pos : size;
+      memcpy (buffer, line + pos, n);
+      pos += n;
+      if (pos == done) 
+        {
+          memmove (line, line + done, len - done);
+          len -= done;
+          pos = done = 0;
+        }
+    }
+  else if (eof && n == 0)
+    eof = false;
+  lock_release (&tty_lock);
+
+  return n;
+}
+
+/* Returns true if tty_read() would return without waiting.  In
+   canonical mode, cooks whatever input has arrived to find out.
+   Returns false if another thread is reading. */
+bool
+tty_ready (void) 
+{
+  bool ready;
+
+  if (!lock_try_acquire (&tty_lock))
+    return false;
+  if (mode == TTY_CANONICAL) 
+    {
+      int c;
+      while (pos == done && !eof && (c = next_byte (false)) != -1)
+        cook (c);
+      ready = pos < done || eof;
+    }
+  else 
+    {
+      enum intr_level old_level = intr_disable ();
+      ready = pos < done || !input_empty ();
+      intr_set_level (old_level);
+    }
+  lock_release (&tty_lock);
+
+  return ready;
+}
+
+/* Switches console input to NEW_MODE and returns the old mode.
+   A partly edited line is passed through as-is to raw mode. */
+enum tty_mode
+tty_set_mode (enum tty_mode new_mode) 
+{
+  enum tty_mode old_mode;
+
+  lock_acquire (&tty_lock);
+  old_mode = mode;
+  mode = new_mode;
+  if (mode == TTY_RAW)
+    {
+      done = len;
+      eof = false;
+    }
+  lock_release (&tty_lock);
+
+  return old_mode;
+}
+
+/* Returns the next byte of input.  If there is none, waits for
+   one if BLOCK is true, otherwise returns -1. */
+static int
+next_byte (bool block) 
+{
+  enum intr_level old_level = intr_disable ();
+  int c = block || !input_empty () ? input_getc () : -1;
+  intr_set_level (old_level);
+  return c;
+}
+
+/* Applies input byte C to the line being edited. */
+static void
+cook (uint8_t c) 
+{
+  switch (c) 
+    {
+    case '\r':
+    case '\n':
+      if (len < LINE_MAX)
+        line[len++] = '\n';
+      done = len;
+      putbuf ("\n", 1);
+      break;
+
+    case '\b':
+    case 0x7f:
+      if (len > done) 
+        {
+          len--;
+          putbuf ("\b \b", 3);
+        }
+      break;
+
+    case CTRL ('U'):
+      while (len > done) 
+        {
+          len--;
+          putbuf ("\b \b", 3);
+        }
+      break;
+
+    case CTRL ('D'):
+      if (len > done)
+        done = len;
+      else
+        eof = true;
+      break;
+
+    default:
+      /* Leave room for the new-line. */
+      if (len < LINE_MAX - 1) 
+        {
+          line[len++] = c;
+          putbuf ((const char *) &c, 1);
+        }
+      break;
+    }
+}
@@ -0,0 +1,20 @@
+#ifndef DEVICES_TTY_H
+#define DEVICES_TTY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Console input modes.  Same values as TTY_CANONICAL and TTY_RAW
+   in lib/user/syscall.h. */
+enum tty_mode
+  {
+    TTY_CANONICAL,              /* Whole lines, edited and echoed. */
+    TTY_RAW                     /* Bytes as they arrive, no echo. */
+  };
+
+void tty_init (void);
+size_t tty_read (void *, size_t);
+bool tty_ready (void);
+enum tty_mode tty_set_mode (enum tty_mode);
+
+#endif /* devices/tty.h */
@@ -14,23 +14,44 @@
 #define COL_CNT 80
 #define ROW_CNT 25
 
+/* Number of rows in the framebuffer, of which ROW_CNT are
+   displayed at a time.  Text mode has 32 kB of video memory,
+   enough for 204 rows.
+
+   Scrolling moves the displayed window down by one row, by
+   reprogramming the CRTC start address, and clears just the row
+   that comes into view.  Only when the window reaches the end of
+   the framebuffer is the screen copied, back to the top, so a
+   full-screen copy happens once per VROW_CNT - ROW_CNT + 1
+   lines instead of once per line. */
+#define VROW_CNT 200
+
 /* Current cursor position.  (0,0) is in the upper left corner of
    the display. */
 static size_t cx, cy;
 
+/* Framebuffer row shown at the top of the display. */
+static size_t top;
+
+/* CRTC start address and cursor location last written to the
+   hardware, to avoid rewriting them when they do not change. */
+static uint16_t hw_start, hw_cursor;
+
 /* Attribute value for gray text on a black background. */
 #define GRAY_ON_BLACK 0x07
 
 /* Framebuffer.  See [FREEVGA] under "VGA Text Mode Operation".
-   The character at (x,y) is fb[y][x][0].
-   The attribute at (x,y) is fb[y][x][1]. */
+   The character at display position (x,y) is fb[top + y][x][0].
+   The attribute at (x,y) is fb[top + y][x][1]. */
 static uint8_t (*fb)[COL_CNT][2];
 
+static void put_char (int c, enum intr_level old_level);
 static void clear_row (size_t y);
 static void cls (void);
 static void newline (void);
 static void move_cursor (void);
 static void find_cursor (size_t *x, size_t *y);
+static void crtc_write (uint8_t index, uint16_t value);
 
 /* Initializes the VGA text display. */
 static void
@@ -42,6 +63,8 @@ init (void)
     {
       fb = ptov (0xb8000);
       find_cursor (&cx, &cy);
+      hw_cursor = cx + COL_CNT * cy;
+      crtc_write (0x0c, 0);             /* Show framebuffer row 0 on top. */
       inited = true; 
     }
 }
@@ -56,7 +79,38 @@ vga_putc (int c)
   enum intr_level old_level = intr_disable ();
 
   init ();
-  
+  put_char (c, old_level);
+
+  /* Update cursor position. */
+  move_cursor ();
+
+  intr_set_level (old_level);
+}
+
+/* Writes the N characters in BUFFER to the VGA text display, as
+   vga_putc() would, but updates the hardware cursor and scroll
+   position only once at the end, since each update takes slow
+   port writes.  BUFFER must not be in user memory. */
+void
+vga_putbuf (const char *buffer, size_t n) 
+{
+  enum intr_level old_level = intr_disable ();
+
+  init ();
+  while (n-- > 0)
+    put_char (*buffer++, old_level);
+  move_cursor ();
+
+  intr_set_level (old_level);
+}
+
+/* Writes C to the framebuffer without moving the hardware
+   cursor or scrolling the display.  Interrupts must be off;
+   OLD_LEVEL is the level to restore briefly to beep the
+   speaker. */
+static void
+put_char (int c, enum intr_level old_level) 
+{
   switch (c) 
     {
     case '\n':
@@ -89,17 +143,12 @@ vga_putc (int c)
       break;
       
     default:
-      fb[cy][cx][0] = c;
-      fb[cy][cx][1] = GRAY_ON_BLACK;
+      fb[top + cy][cx][0] = c;
+      fb[top + cy][cx][1] = GRAY_ON_BLACK;
       if (++cx >= COL_CNT)
         newline ();
       break;
     }
-
-  /* Update cursor position. */
-  move_cursor ();
-
-  intr_set_level (old_level);
 }
 
 /* Clears the screen and moves the cursor to the upper left. */
@@ -111,11 +160,11 @@ cls (void)
   for (y = 0; y < ROW_CNT; y++)
     clear_row (y);
 
-  cx = cy = 0;
+  cx = cy = top = 0;
   move_cursor ();
 }
 
-/* Clears row Y to spaces. */
+/* Clears framebuffer row Y to spaces. */
 static void
 clear_row (size_t y) 
 {
@@ -130,7 +179,8 @@ clear_row (size_t y)
 
 /* Advances the cursor to the first column in the next line on
    the screen.  If the cursor is already on the last line on the
-   screen, scrolls the screen upward one line. */
+   screen, scrolls the screen upward one line.  The hardware
+   catches up at the next move_cursor(). */
 static void
 newline (void)
 {
@@ -139,19 +189,47 @@ newline (void)
   if (cy >= ROW_CNT)
     {
       cy = ROW_CNT - 1;
-      memmove (&fb[0], &fb[1], sizeof fb[0] * (ROW_CNT - 1));
-      clear_row (ROW_CNT - 1);
+      top++;
+      if (top + ROW_CNT > VROW_CNT) 
+        {
+          /* Out of framebuffer: wrap the rows still in view
+             around to the top. */
+          memcpy (&fb[0], &fb[top], sizeof fb[0] * (ROW_CNT - 1));
+          top = 0;
+        }
+      clear_row (top + ROW_CNT - 1);
     }
 }
 
-/* Moves the hardware cursor to (cx,cy). */
+/* Moves the hardware cursor to (cx,cy) and scrolls the display
+   to show framebuffer row TOP at the top. */
 static void
 move_cursor (void) 
 {
-  /* See [FREEVGA] under "Manipulating the Text-mode Cursor". */
-  uint16_t cp = cx + COL_CNT * cy;
-  outw (0x3d4, 0x0e | (cp & 0xff00));
-  outw (0x3d4, 0x0f | (cp << 8));
+  /* See [FREEVGA] under "CRTC Registers" and "Manipulating the
+     Text-mode Cursor". */
+  uint16_t start = COL_CNT * top;
+  uint16_t cp = start + cx + COL_CNT * cy;
+
+  if (start != hw_start)
+    {
+      crtc_write (0x0c, start);
+      hw_start = start;
+    }
+  if (cp != hw_cursor)
+    {
+      crtc_write (0x0e, cp);
+      hw_cursor = cp;
+    }
+}
+
+/* Writes VALUE to the pair of CRTC registers starting at INDEX,
+   high byte first. */
+static void
+crtc_write (uint8_t index, uint16_t value) 
+{
+  outw (0x3d4, index | (value & 0xff00));
+  outw (0x3d4, (index + 1) | (value << 8));
 }
 
 /* Reads the current hardware cursor position into (*X,*Y). */
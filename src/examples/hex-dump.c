@@ -10,6 +10,10 @@ main (int argc, char *argv[])
 {
   bool success = true;
   int i;
+
+  /* hex_dump() prints a line in dozens of pieces, so collect a
+     whole buffer of them before writing. */
+  hsetvbuf (STDOUT_FILENO, _IOFBF);
   
   for (i = 1; i < argc; i++) 
     {
@@ -326,6 +326,7 @@ main (int argc, char *argv[])
         usage (-1, "Unrecognized flag");
     }
 
+  hsetvbuf (handle, _IOFBF);
   init_grammar ();
 
   random_init (new_seed);
@@ -3,8 +3,7 @@
 #include <string.h>
 #include <syscall.h>
 
-static void read_line (char line[], size_t);
-static bool backspace (char **pos, char line[]);
+static bool read_line (char line[], size_t);
 
 int
 main (void)
@@ -16,7 +15,8 @@ main (void)
 
       /* Read command. */
       printf ("--");
-      read_line (command, sizeof command);
+      if (!read_line (command, sizeof command))
+        break;
       
       /* Execute command. */
       if (!strcmp (command, "exit"))
@@ -45,60 +45,25 @@ main (void)
 }
 
 /* Reads a line of input from the user into LINE, which has room
-   for SIZE bytes.  Handles backspace and Ctrl+U in the ways
-   expected by Unix users.  On return, LINE will always be
-   null-terminated and will not end in a new-line character. */
-static void
+   for SIZE bytes.  The kernel's line discipline echoes the line
+   and handles backspace and Ctrl+U in the ways expected by Unix
+   users.  Returns false at end of file (Ctrl+D).  On success,
+   LINE will be null-terminated and will not end in a new-line
+   character; the rest of a line too long for LINE is discarded. */
+static bool
 read_line (char line[], size_t size) 
 {
-  char *pos = line;
-  for (;;)
-    {
-      char c;
-      read (STDIN_FILENO, &c, 1);
-
-      switch (c) 
-        {
-        case '\r':
-          *pos = '\0';
-          putchar ('\n');
-          return;
-
-        case '\b':
-          backspace (&pos, line);
-          break;
+  int len = hgetline (STDIN_FILENO, line, size);
 
-        case ('U' - 'A') + 1:       /* Ctrl+U. */
-          while (backspace (&pos, line))
-            continue;
-          break;
-
-        default:
-          /* Add character to line. */
-          if (pos < line + size - 1) 
-            {
-              putchar (c);
-              *pos++ = c;
-            }
-          break;
-        }
-    }
-}
-
-/* If *POS is past the beginning of LINE, backs up one character
-   position.  Returns true if successful, false if nothing was
-   done. */
-static bool
-backspace (char **pos, char line[]) 
-{
-  if (*pos > line)
+  if (len < 0)
+    return false;
+  if (len > 0 && line[len - 1] == '\n')
+    line[len - 1] = '\0';
+  else 
     {
-      /* Back up cursor, overwrite character, back up
-         again. */
-      printf ("\b \b");
-      (*pos)--;
-      return true;
+      int c;
+      while ((c = getchar ()) != '\n' && c != EOF)
+        continue;
     }
-  else
-    return false;
+  return true;
 }
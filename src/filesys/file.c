@@ -1,7 +1,14 @@
 #include "filesys/file.h"
 #include <debug.h>
+#include <poll.h>
 #include "filesys/inode.h"
+#include "filesys/pipe.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Largest buffer file_copy() uses, in pages. */
+#define COPY_PAGES 4
 
 /* An open file. */
 struct file 
@@ -9,6 +16,8 @@ struct file
     struct inode *inode;        /* File's inode. */
     off_t pos;                  /* Current position. */
     bool deny_write;            /* Has file_deny_write() been called? */
+    struct pipe *pipe;          /* Pipe, if this is a pipe end. */
+    bool pipe_writer;           /* Write end of PIPE? */
   };
 
 /* Opens a file for the given INODE, of which it takes ownership,
@@ -33,19 +42,78 @@ file_open (struct inode *inode)
     }
 }
 
+/* Opens and returns a file for an end of PIPE, the write end if
+   WRITER is true, otherwise the read end.  The file takes over
+   one of PIPE's references to that end.  Returns a null pointer
+   if an allocation fails. */
+struct file *
+file_open_pipe (struct pipe *pipe, bool writer) 
+{
+  struct file *file = calloc (1, sizeof *file);
+  if (file != NULL)
+    {
+      file->pipe = pipe;
+      file->pipe_writer = writer;
+    }
+  return file;
+}
+
 /* Opens and returns a new file for the same inode as FILE.
-   Returns a null pointer if unsuccessful. */
+   Returns a null pointer if unsuccessful, or if FILE is a pipe
+   end, which has no inode. */
 struct file *
 file_reopen (struct file *file) 
 {
+  if (file->pipe != NULL)
+    return NULL;
   return file_open (inode_reopen (file->inode));
 }
 
+/* Returns a new file like FILE: another end of the same pipe if
+   FILE is a pipe end, otherwise as file_reopen().  Returns a null
+   pointer if unsuccessful. */
+struct file *
+file_dup (struct file *file) 
+{
+  struct file *dup;
+
+  if (file->pipe == NULL)
+    return file_reopen (file);
+  pipe_open (file->pipe, file->pipe_writer);
+  dup = file_open_pipe (file->pipe, file->pipe_writer);
+  if (dup == NULL)
+    pipe_close (file->pipe, file->pipe_writer);
+  return dup;
+}
+
+/* Returns true if FILE is an end of a pipe. */
+bool
+file_is_pipe (const struct file *file) 
+{
+  return file->pipe != NULL;
+}
+
+/* Returns the events among POLLIN and POLLOUT in EVENTS that
+   FILE is ready for, plus POLLERR or POLLHUP if they apply.  Only
+   pipes ever make a reader or writer wait. */
+int
+file_poll (struct file *file, int events) 
+{
+  if (file->pipe != NULL)
+    return pipe_poll (file->pipe, file->pipe_writer, events);
+  return events & (POLLIN | POLLOUT);
+}
+
 /* Closes FILE. */
 void
 file_close (struct file *file) 
 {
-  if (file != NULL)
+  if (file != NULL && file->pipe != NULL)
+    {
+      pipe_close (file->pipe, file->pipe_writer);
+      free (file);
+    }
+  else if (file != NULL)
     {
       file_allow_write (file);
       inode_close (file->inode);
@@ -64,11 +132,16 @@ file_get_inode (struct file *file)
    starting at the file's current position.
    Returns the number of bytes actually read,
    which may be less than SIZE if end of file is reached.
-   Advances FILE's position by the number of bytes read. */
+   Advances FILE's position by the number of bytes read.
+   A pipe's read end reads as pipe_read() does instead. */
 off_t
 file_read (struct file *file, void *buffer, off_t size) 
 {
-  off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+  off_t bytes_read;
+
+  if (file->pipe != NULL)
+    return file->pipe_writer ? -1 : pipe_read (file->pipe, buffer, size);
+  bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
   file->pos += bytes_read;
   return bytes_read;
 }
@@ -81,6 +154,8 @@ file_read (struct file *file, void *buffer, off_t size)
 off_t
 file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs) 
 {
+  if (file->pipe != NULL)
+    return -1;
   return inode_read_at (file->inode, buffer, size, file_ofs);
 }
 
@@ -90,11 +165,16 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs)
    which may be less than SIZE if end of file is reached.
    (Normally we'd grow the file in that case, but file growth is
    not yet implemented.)
-   Advances FILE's position by the number of bytes read. */
+   Advances FILE's position by the number of bytes read.
+   A pipe's write end writes as pipe_write() does instead. */
 off_t
 file_write (struct file *file, const void *buffer, off_t size) 
 {
-  off_t bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
+  off_t bytes_written;
+
+  if (file->pipe != NULL)
+    return file->pipe_writer ? pipe_write (file->pipe, buffer, size) : -1;
+  bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
   file->pos += bytes_written;
   return bytes_written;
 }
@@ -110,9 +190,57 @@ off_t
 file_write_at (struct file *file, const void *buffer, off_t size,
                off_t file_ofs) 
 {
+  if (file->pipe != NULL)
+    return -1;
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Copies up to SIZE bytes from SRC, starting at its current
+   position, to DST at its current position, and advances both
+   positions by the number of bytes copied.  Returns that number,
+   which may be less than SIZE if the end of SRC is reached, if
+   DST cannot grow, or if no buffer could be allocated.
+
+   The data moves through a kernel buffer of up to COPY_PAGES
+   pages, so that most transfers cover many whole sectors. */
+off_t
+file_copy (struct file *dst, struct file *src, off_t size) 
+{
+  size_t page_cnt = COPY_PAGES;
+  off_t copied = 0;
+  void *buffer;
+
+  while ((buffer = palloc_get_multiple (0, page_cnt)) == NULL && page_cnt > 1)
+    page_cnt /= 2;
+  if (buffer == NULL)
+    return 0;
+
+  while (copied < size)
+    {
+      off_t chunk = size - copied;
+      off_t bytes_read, bytes_written;
+
+      if (chunk > (off_t) (page_cnt * PGSIZE))
+        chunk = page_cnt * PGSIZE;
+      bytes_read = file_read (src, buffer, chunk);
+      if (bytes_read == 0)
+        break;
+      bytes_written = file_write (dst, buffer, bytes_read);
+      copied += bytes_written;
+      if (bytes_written < bytes_read)
+        {
+          /* Leave SRC just past what made it into DST. */
+          src->pos -= bytes_read - bytes_written;
+          break;
+        }
+      if (bytes_read < chunk)
+        break;
+    }
+
+  palloc_free_multiple (buffer, page_cnt);
+  return copied;
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
@@ -145,7 +273,7 @@ off_t
 file_length (struct file *file) 
 {
   ASSERT (file != NULL);
-  return inode_length (file->inode);
+  return file->pipe != NULL ? 0 : inode_length (file->inode);
 }
 
 /* Sets the current position in FILE to NEW_POS bytes from the
@@ -77,9 +77,10 @@ fsutil_extract (char **argv UNUSED)
   struct block *src;
   void *header, *data;
 
-  /* Allocate buffers. */
+  /* Allocate buffers.  File data is copied a page's worth of
+     sectors at a time. */
   header = malloc (BLOCK_SECTOR_SIZE);
-  data = malloc (BLOCK_SECTOR_SIZE);
+  data = palloc_get_page (0);
   if (header == NULL || data == NULL)
     PANIC ("couldn't allocate buffers");
 
@@ -127,10 +128,11 @@ fsutil_extract (char **argv UNUSED)
           /* Do copy. */
           while (size > 0)
             {
-              int chunk_size = (size > BLOCK_SECTOR_SIZE
-                                ? BLOCK_SECTOR_SIZE
-                                : size);
-              block_read (src, sector++, data);
+              int chunk_size = (size > PGSIZE ? PGSIZE : size);
+              int i;
+
+              for (i = 0; i * BLOCK_SECTOR_SIZE < chunk_size; i++)
+                block_read (src, sector++, data + i * BLOCK_SECTOR_SIZE);
               if (file_write (dst, data, chunk_size) != chunk_size)
                 PANIC ("%s: write failed with %d bytes unwritten",
                        file_name, size);
@@ -151,7 +153,7 @@ fsutil_extract (char **argv UNUSED)
   block_write (src, 0, header);
   block_write (src, 1, header);
 
-  free (data);
+  palloc_free_page (data);
   free (header);
 }
 
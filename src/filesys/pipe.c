@@ -0,0 +1,239 @@
+#include "filesys/pipe.h"
+#include <debug.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "userprog/poll.h"
+
+/* Anonymous pipes.
+
+   A pipe's data lives in a ring of PIPE_PAGES kernel pages.  The
+   head and tail counters only grow; a byte's place in the ring is
+   its counter modulo the ring size.  Data is copied straight
+   between the ring and the user's buffer, a page-sized piece at a
+   time, with no staging buffer in between.
+
+   Readers wait while the ring is empty and writers wait while it
+   is full, each on a condition variable under the pipe's lock.
+   With no writers left, a read of an empty pipe returns 0.  With
+   no readers left, a write fails.  Each of these changes also
+   wakes threads waiting in poll(). */
+
+/* Pages in a pipe's ring. */
+#define PIPE_PAGES 4
+#define PIPE_SIZE (PIPE_PAGES * PGSIZE)
+
+struct pipe
+  {
+    struct lock lock;           /* Protects all members. */
+    struct condition readable;  /* Signaled when data arrives. */
+    struct condition writable;  /* Signaled when space is freed. */
+    void *pages[PIPE_PAGES];    /* The ring. */
+    uint32_t head;              /* Bytes ever read. */
+    uint32_t tail;              /* Bytes ever written. */
+    int readers;                /* Open read ends. */
+    int writers;                /* Open write ends. */
+  };
+
+static void *ring_addr (struct pipe *, uint32_t pos, size_t *left);
+
+/* Creates and returns a new pipe with one read end and one write
+   end open, or a null pointer if memory is short. */
+struct pipe *
+pipe_create (void) 
+{
+  struct pipe *p = malloc (sizeof *p);
+  size_t i;
+
+  if (p == NULL)
+    return NULL;
+  for (i = 0; i < PIPE_PAGES; i++) 
+    {
+      p->pages[i] = palloc_get_page (0);
+      if (p->pages[i] == NULL)
+        {
+          while (i-- > 0)
+            palloc_free_page (p->pages[i]);
+          free (p);
+          return NULL;
+        }
+    }
+  lock_init (&p->lock);
+  cond_init (&p->readable);
+  cond_init (&p->writable);
+  p->head = p->tail = 0;
+  p->readers = p->writers = 1;
+  return p;
+}
+
+/* Opens another read end of P, or a write end if WRITER. */
+void
+pipe_open (struct pipe *p, bool writer) 
+{
+  lock_acquire (&p->lock);
+  if (writer)
+    p->writers++;
+  else
+    p->readers++;
+  lock_release (&p->lock);
+}
+
+/* Closes a read end of P, or a write end if WRITER, and frees P
+   when that was the last end. */
+void
+pipe_close (struct pipe *p, bool writer) 
+{
+  bool last;
+  size_t i;
+
+  lock_acquire (&p->lock);
+  if (writer)
+    {
+      ASSERT (p->writers > 0);
+      if (--p->writers == 0) 
+        {
+          cond_broadcast (&p->readable, &p->lock);
+          poll_wake ();
+        }
+    }
+  else
+    {
+      ASSERT (p->readers > 0);
+      if (--p->readers == 0) 
+        {
+          cond_broadcast (&p->writable, &p->lock);
+          poll_wake ();
+        }
+    }
+  last = p->readers == 0 && p->writers == 0;
+  lock_release (&p->lock);
+
+  if (last)
+    {
+      for (i = 0; i < PIPE_PAGES; i++)
+        palloc_free_page (p->pages[i]);
+      free (p);
+    }
+}
+
+/* Reads up to SIZE bytes from P into BUFFER, waiting until at
+   least one byte is available.  Returns the number of bytes read,
+   which is 0 only at end of file, when the pipe is empty and has
+   no writers. */
+off_t
+pipe_read (struct pipe *p, void *buffer_, off_t size) 
+{
+  uint8_t *buffer = buffer_;
+  off_t bytes_read = 0;
+
+  lock_acquire (&p->lock);
+  while (p->head == p->tail && p->writers > 0 && size > 0)
+    cond_wait (&p->readable, &p->lock);
+  while (bytes_read < size && p->head != p->tail)
+    {
+      size_t left;
+      void *src = ring_addr (p, p->head, &left);
+      size_t chunk = size - bytes_read;
+
+      if (chunk > left)
+        chunk = left;
+      if (chunk > p->tail - p->head)
+        chunk = p->tail - p->head;
+      memcpy (buffer + bytes_read, src, chunk);
+      p->head += chunk;
+      bytes_read += chunk;
+    }
+  if (bytes_read > 0) 
+    {
+      cond_broadcast (&p->writable, &p->lock);
+      poll_wake ();
+    }
+  lock_release (&p->lock);
+  return bytes_read;
+}
+
+/* Writes all SIZE bytes from BUFFER to P, waiting for readers to
+   make room as needed.  Returns the number of bytes written,
+   which is less than SIZE only if the last reader goes away, or
+   -1 if there was no reader to begin with. */
+off_t
+pipe_write (struct pipe *p, const void *buffer_, off_t size) 
+{
+  const uint8_t *buffer = buffer_;
+  off_t bytes_written = 0;
+
+  lock_acquire (&p->lock);
+  if (p->readers == 0)
+    {
+      lock_release (&p->lock);
+      return -1;
+    }
+  while (bytes_written < size && p->readers > 0)
+    {
+      size_t left, space;
+      void *dst;
+      size_t chunk;
+
+      while (p->tail - p->head == PIPE_SIZE && p->readers > 0)
+        cond_wait (&p->writable, &p->lock);
+      if (p->readers == 0)
+        break;
+
+      dst = ring_addr (p, p->tail, &left);
+      space = PIPE_SIZE - (p->tail - p->head);
+      chunk = size - bytes_written;
+      if (chunk > left)
+        chunk = left;
+      if (chunk > space)
+        chunk = space;
+      memcpy (dst, buffer + bytes_written, chunk);
+      p->tail += chunk;
+      bytes_written += chunk;
+      cond_broadcast (&p->readable, &p->lock);
+      poll_wake ();
+    }
+  lock_release (&p->lock);
+  return bytes_written;
+}
+
+/* Returns the events among POLLIN and POLLOUT in EVENTS that a
+   read end of P, or a write end if WRITER, is ready for.  Adds
+   POLLHUP to a read end once there are no writers, and POLLERR to
+   a write end once there are no readers. */
+int
+pipe_poll (struct pipe *p, bool writer, int events) 
+{
+  int revents = 0;
+
+  lock_acquire (&p->lock);
+  if (writer)
+    {
+      if (p->readers == 0)
+        revents |= POLLERR;
+      else if (p->tail - p->head < PIPE_SIZE)
+        revents |= events & POLLOUT;
+    }
+  else
+    {
+      if (p->head != p->tail)
+        revents |= events & POLLIN;
+      if (p->writers == 0)
+        revents |= POLLHUP;
+    }
+  lock_release (&p->lock);
+  return revents;
+}
+
+/* Returns the address in P's ring of the byte at counter POS,
+   and in *LEFT the number of bytes from there to the end of its
+   page. */
+static void *
+ring_addr (struct pipe *p, uint32_t pos, size_t *left) 
+{
+  size_t ofs = pos % PGSIZE;
+
+  *left = PGSIZE - ofs;
+  return (uint8_t *) p->pages[pos / PGSIZE % PIPE_PAGES] + ofs;
+}
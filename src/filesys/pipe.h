@@ -0,0 +1,16 @@
+#ifndef FILESYS_PIPE_H
+#define FILESYS_PIPE_H
+
+#include <stdbool.h>
+#include "filesys/off_t.h"
+
+struct pipe;
+
+struct pipe *pipe_create (void);
+void pipe_open (struct pipe *, bool writer);
+void pipe_close (struct pipe *, bool writer);
+off_t pipe_read (struct pipe *, void *, off_t);
+off_t pipe_write (struct pipe *, const void *, off_t);
+int pipe_poll (struct pipe *, bool writer, int events);
+
+#endif /* filesys/pipe.h */
@@ -0,0 +1,23 @@
+#ifndef __LIB_POLL_H
+#define __LIB_POLL_H
+
+/* One descriptor of a poll() system call. */
+struct pollfd
+  {
+    int fd;                     /* Descriptor, or negative to skip. */
+    short events;               /* Events of interest. */
+    short revents;              /* Events found, set by poll(). */
+  };
+
+/* Event bits.  POLLERR, POLLHUP, and POLLNVAL are reported in
+   `revents' whether or not they are in `events'. */
+#define POLLIN 0x001            /* Reading would not wait. */
+#define POLLOUT 0x004           /* Writing would not wait. */
+#define POLLERR 0x008           /* Pipe write end with no readers. */
+#define POLLHUP 0x010           /* Pipe read end with no writers. */
+#define POLLNVAL 0x020          /* Descriptor not open. */
+
+/* Most descriptors a single poll() accepts. */
+#define POLL_MAX 64
+
+#endif /* lib/poll.h */
@@ -0,0 +1,24 @@
+#ifndef __LIB_SHARED_PAGE_H
+#define __LIB_SHARED_PAGE_H
+
+#include <stdint.h>
+
+/* A page that the kernel maps read-only into every user process
+   at SHARED_PAGE_VADDR, just below the program's code, so that
+   user programs can read the time without a system call.
+
+   The kernel bumps SEQ before and after each update, so it is
+   odd while an update is in progress.  Readers must retry if SEQ
+   is odd or changes while they read; see get_ticks() in
+   lib/user/syscall.c. */
+#define SHARED_PAGE_VADDR 0x08047000
+
+struct shared_page
+  {
+    volatile uint32_t seq;      /* Update sequence number. */
+    volatile int64_t ticks;     /* timer_ticks(). */
+    uint32_t timer_freq;        /* Timer ticks per second. */
+    volatile uint32_t process_cnt; /* Running user processes. */
+  };
+
+#endif /* lib/shared-page.h */
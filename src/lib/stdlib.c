@@ -1,8 +1,11 @@
 #include <ctype.h>
 #include <debug.h>
+#include <limits.h>
 #include <random.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 
 /* Converts a string representation of a signed decimal integer
    in S into an `int', which is returned. */
@@ -52,7 +55,7 @@ compare_thunk (const void *a, const void *b, void *aux)
    using COMPARE.  When COMPARE is passed a pair of elements A
    and B, respectively, it must return a strcmp()-type result,
    i.e. less than zero if A < B, zero if A == B, greater than
-   zero if A > B.  Runs in O(n lg n) time and O(1) space in
+   zero if A > B.  Runs in O(n lg n) time and O(lg n) space in
    CNT. */
 void
 qsort (void *array, size_t cnt, size_t size,
@@ -61,21 +64,44 @@ qsort (void *array, size_t cnt, size_t size,
   sort (array, cnt, size, compare_thunk, &compare);
 }
 
+/* Swaps the SIZE-byte elements at A and B, a word at a time if
+   both are word-aligned and SIZE is a multiple of the word
+   size, as it is for arrays of ints and pointers. */
+static inline void
+swap_elems (unsigned char *a, unsigned char *b, size_t size) 
+{
+  if (((uintptr_t) a | (uintptr_t) b | size) % sizeof (uint32_t) == 0)
+    {
+      uint32_t *wa = (uint32_t *) a;
+      uint32_t *wb = (uint32_t *) b;
+      size_t i;
+
+      for (i = 0; i < size / sizeof (uint32_t); i++)
+        {
+          uint32_t t = wa[i];
+          wa[i] = wb[i];
+          wb[i] = t;
+        }
+    }
+  else 
+    {
+      size_t i;
+
+      for (i = 0; i < size; i++)
+        {
+          unsigned char t = a[i];
+          a[i] = b[i];
+          b[i] = t;
+        }
+    }
+}
+
 /* Swaps elements with 1-based indexes A_IDX and B_IDX in ARRAY
    with elements of SIZE bytes each. */
 static void
 do_swap (unsigned char *array, size_t a_idx, size_t b_idx, size_t size)
 {
-  unsigned char *a = array + (a_idx - 1) * size;
-  unsigned char *b = array + (b_idx - 1) * size;
-  size_t i;
-
-  for (i = 0; i < size; i++)
-    {
-      unsigned char t = a[i];
-      a[i] = b[i];
-      b[i] = t;
-    }
+  swap_elems (array + (a_idx - 1) * size, array + (b_idx - 1) * size, size);
 }
 
 /* Compares elements with 1-based indexes A_IDX and B_IDX in
@@ -122,33 +148,245 @@ heapify (unsigned char *array, size_t i, size_t cnt, size_t size,
     }
 }
 
+/* Sorts ARRAY, which contains CNT elements of SIZE bytes each,
+   with heap sort, using COMPARE to compare elements, passing AUX
+   as auxiliary data. */
+static void
+heap_sort (unsigned char *array, size_t cnt, size_t size,
+           int (*compare) (const void *, const void *, void *aux),
+           void *aux) 
+{
+  size_t i;
+
+  /* Build a heap. */
+  for (i = cnt / 2; i > 0; i--)
+    heapify (array, i, cnt, size, compare, aux);
+
+  /* Sort the heap. */
+  for (i = cnt; i > 1; i--) 
+    {
+      do_swap (array, 1, i, size);
+      heapify (array, 1, i - 1, size, compare, aux); 
+    }
+}
+
+/* Sorts ARRAY, which contains CNT elements of SIZE bytes each,
+   with insertion sort, using COMPARE to compare elements,
+   passing AUX as auxiliary data. */
+static void
+insertion_sort (unsigned char *array, size_t cnt, size_t size,
+                int (*compare) (const void *, const void *, void *aux),
+                void *aux) 
+{
+  unsigned char *end = array + cnt * size;
+  unsigned char *p, *q;
+
+  for (p = array + size; p < end; p += size)
+    for (q = p; q > array && compare (q - size, q, aux) > 0; q -= size)
+      swap_elems (q - size, q, size);
+}
+
+/* Arrays this small are finished with insertion sort. */
+#define INSERTION_MAX 12
+
+/* Sorts ARRAY, which contains CNT elements of SIZE bytes each,
+   using COMPARE to compare elements, passing AUX as auxiliary
+   data.  Falls back to heap sort if DEPTH levels of partitioning
+   are not enough, which bounds the worst case at O(n lg n). */
+static void
+intro_sort (unsigned char *array, size_t cnt, size_t size,
+            int (*compare) (const void *, const void *, void *aux),
+            void *aux, int depth) 
+{
+  while (cnt > INSERTION_MAX) 
+    {
+      unsigned char *first = array;
+      unsigned char *mid = array + cnt / 2 * size;
+      unsigned char *last = array + (cnt - 1) * size;
+      unsigned char *i, *j;
+      size_t left_cnt, right_cnt;
+
+      if (depth-- == 0) 
+        {
+          heap_sort (array, cnt, size, compare, aux);
+          return;
+        }
+
+      /* Order FIRST, MID, LAST, so that MID is the median of the
+         three, then move it to the front as the pivot.  LAST,
+         being no less than the pivot, stops the upward scan
+         below, and the pivot itself stops the downward one. */
+      if (compare (mid, first, aux) < 0)
+        swap_elems (mid, first, size);
+      if (compare (last, mid, aux) < 0) 
+        {
+          swap_elems (last, mid, size);
+          if (compare (mid, first, aux) < 0)
+            swap_elems (mid, first, size);
+        }
+      swap_elems (first, mid, size);
+
+      /* Partition around the pivot at FIRST. */
+      i = first + size;
+      j = last;
+      for (;;) 
+        {
+          while (compare (i, first, aux) < 0)
+            i += size;
+          while (compare (first, j, aux) < 0)
+            j -= size;
+          if (i >= j)
+            break;
+          swap_elems (i, j, size);
+          i += size;
+          j -= size;
+        }
+      swap_elems (first, j, size);
+
+      /* Recurse on the smaller side and loop on the larger, so
+         that the stack holds at most lg CNT frames. */
+      left_cnt = (j - array) / size;
+      right_cnt = cnt - left_cnt - 1;
+      if (left_cnt < right_cnt) 
+        {
+          intro_sort (array, left_cnt, size, compare, aux, depth);
+          array = j + size;
+          cnt = right_cnt;
+        }
+      else 
+        {
+          intro_sort (j + size, right_cnt, size, compare, aux, depth);
+          cnt = left_cnt;
+        }
+    }
+  insertion_sort (array, cnt, size, compare, aux);
+}
+
 /* Sorts ARRAY, which contains CNT elements of SIZE bytes each,
    using COMPARE to compare elements, passing AUX as auxiliary
    data.  When COMPARE is passed a pair of elements A and B,
    respectively, it must return a strcmp()-type result, i.e. less
    than zero if A < B, zero if A == B, greater than zero if A >
-   B.  Runs in O(n lg n) time and O(1) space in CNT. */
+   B.  Runs in O(n lg n) time and O(lg n) space in CNT.
+
+   This is introsort: quicksort with median-of-three pivots,
+   insertion sort for small partitions, and heap sort for
+   partitions that recurse too deeply. */
 void
 sort (void *array, size_t cnt, size_t size,
       int (*compare) (const void *, const void *, void *aux),
       void *aux) 
 {
-  size_t i;
+  int depth;
+  size_t n;
 
   ASSERT (array != NULL || cnt == 0);
   ASSERT (compare != NULL);
   ASSERT (size > 0);
 
-  /* Build a heap. */
-  for (i = cnt / 2; i > 0; i--)
-    heapify (array, i, cnt, size, compare, aux);
+  depth = 0;
+  for (n = cnt; n > 1; n /= 2)
+    depth += 2;
+  intro_sort (array, cnt, size, compare, aux, depth);
+}
 
-  /* Sort the heap. */
-  for (i = cnt; i > 1; i--) 
+/* Sorts the CNT bytes in ARRAY into nondecreasing order, with a
+   counting sort.  Runs in O(n) time. */
+void
+sort_bytes (unsigned char *array, size_t cnt) 
+{
+  size_t counts[UCHAR_MAX + 1];
+  size_t i;
+  int value;
+
+  ASSERT (array != NULL || cnt == 0);
+
+  for (value = 0; value <= UCHAR_MAX; value++)
+    counts[value] = 0;
+  for (i = 0; i < cnt; i++)
+    counts[array[i]]++;
+  for (value = 0; value <= UCHAR_MAX; value++) 
     {
-      do_swap (array, 1, i, size);
-      heapify (array, 1, i - 1, size, compare, aux); 
+      memset (array, value, counts[value]);
+      array += counts[value];
+    }
+}
+
+/* Compares the uint32_t values at A and B. */
+static int
+compare_uint32 (const void *a_, const void *b_, void *aux UNUSED) 
+{
+  const uint32_t *a = a_;
+  const uint32_t *b = b_;
+  return *a < *b ? -1 : *a > *b;
+}
+
+/* Sorts the CNT values in ARRAY into nondecreasing order, with a
+   radix sort that makes one pass per byte, least significant
+   first, skipping bytes that are the same in every value.  Runs
+   in O(n) time, using O(n) temporary space from malloc().  If
+   that is not available, uses sort() instead. */
+void
+sort_uint32 (uint32_t *array, size_t cnt) 
+{
+  uint32_t *src, *dst;
+  size_t *counts;
+  int shift;
+
+  ASSERT (array != NULL || cnt == 0);
+
+  if (cnt <= INSERTION_MAX) 
+    {
+      insertion_sort ((unsigned char *) array, cnt, sizeof *array,
+                      compare_uint32, NULL);
+      return;
+    }
+  counts = malloc ((UCHAR_MAX + 1) * sizeof *counts + cnt * sizeof *array);
+  if (counts == NULL) 
+    {
+      sort (array, cnt, sizeof *array, compare_uint32, NULL);
+      return;
+    }
+
+  src = array;
+  dst = (uint32_t *) (counts + UCHAR_MAX + 1);
+  for (shift = 0; shift < 32; shift += CHAR_BIT) 
+    {
+      size_t sum, i;
+      int digit;
+
+      for (digit = 0; digit <= UCHAR_MAX; digit++)
+        counts[digit] = 0;
+      for (i = 0; i < cnt; i++)
+        counts[(src[i] >> shift) & UCHAR_MAX]++;
+      if (counts[(src[0] >> shift) & UCHAR_MAX] == cnt)
+        continue;
+
+      /* Turn counts into starting positions, then distribute. */
+      for (sum = 0, digit = 0; digit <= UCHAR_MAX; digit++) 
+        {
+          size_t count = counts[digit];
+          counts[digit] = sum;
+          sum += count;
+        }
+      for (i = 0; i < cnt; i++)
+        dst[counts[(src[i] >> shift) & UCHAR_MAX]++] = src[i];
+
+      /* The output becomes the next pass's input. */
+      if (src == array) 
+        {
+          src = dst;
+          dst = array;
+        }
+      else 
+        {
+          dst = src;
+          src = array;
+        }
     }
+  if (src != array)
+    memcpy (array, src, cnt * sizeof *array);
+  free (counts);
 }
 
 /* Searches ARRAY, which contains CNT elements of SIZE bytes
@@ -2,6 +2,11 @@
 #define __LIB_STDLIB_H
 
 #include <stddef.h>
+#include <stdint.h>
+
+/* Include lib/user/stdlib.h or lib/kernel/stdlib.h, as
+   appropriate. */
+#include_next <stdlib.h>
 
 /* Standard functions. */
 int atoi (const char *);
@@ -18,5 +23,7 @@ void *binary_search (const void *key, const void *array, size_t cnt,
                      size_t size,
                      int (*compare) (const void *, const void *, void *aux),
                      void *aux);
+void sort_bytes (unsigned char *array, size_t cnt);
+void sort_uint32 (uint32_t *array, size_t cnt);
 
 #endif /* lib/stdlib.h */
@@ -1,8 +1,46 @@
 #include <string.h>
 #include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* A 32-bit word that may alias any other type, for the functions
+   below that move or scan memory a word at a time. */
+typedef uint32_t word_t __attribute__ ((__may_alias__));
+
+/* Transfers of at least this many bytes use the x86 string
+   instructions, whose startup cost only pays off for bulk
+   sizes.  Smaller ones use a loop over words. */
+#define REP_MIN 256
+
+/* Returns nonzero if any byte in W is zero.  Subtracting 1 from
+   each byte sets the byte's top bit if it was 0 (or over 0x80),
+   and masking with ~W rules out the bytes over 0x80.  Borrows
+   can only give false positives above a real zero byte, so the
+   test is exact as to whether there is one.
+
+   The string functions below use it to scan aligned words.  An
+   aligned word never straddles a page boundary, so reading the
+   whole word is safe as long as its first byte is part of the
+   string, even at the end of a user page. */
+static inline word_t
+has_zero (word_t w) 
+{
+  return (w - 0x01010101u) & ~w & 0x80808080u;
+}
+
+/* Returns true if P is aligned on a word boundary. */
+static inline bool
+is_aligned (const void *p) 
+{
+  return (uintptr_t) p % sizeof (word_t) == 0;
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
-   Returns DST. */
+   Returns DST.
+
+   Once DST is word-aligned, the bulk of the copy moves a word at
+   a time, with REP MOVSL for large blocks.  Misaligned SRC is
+   fine on x86, just slower. */
 void *
 memcpy (void *dst_, const void *src_, size_t size) 
 {
@@ -12,6 +50,31 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
+  if (size >= 2 * sizeof (word_t)) 
+    {
+      size_t word_cnt;
+
+      while ((uintptr_t) dst % sizeof (word_t) != 0) 
+        {
+          *dst++ = *src++;
+          size--;
+        }
+
+      word_cnt = size / sizeof (word_t);
+      size %= sizeof (word_t);
+      if (word_cnt * sizeof (word_t) >= REP_MIN)
+        asm volatile ("rep movsl"
+                      : "+D" (dst), "+S" (src), "+c" (word_cnt)
+                      : : "memory");
+      else
+        for (; word_cnt > 0; word_cnt--) 
+          {
+            *(word_t *) dst = *(const word_t *) src;
+            dst += sizeof (word_t);
+            src += sizeof (word_t);
+          }
+    }
+
   while (size-- > 0)
     *dst++ = *src++;
 
@@ -19,30 +82,42 @@ memcpy (void *dst_, const void *src_, size_t size)
 }
 
 /* Copies SIZE bytes from SRC to DST, which are allowed to
-   overlap.  Returns DST. */
+   overlap.  Returns DST.
+
+   When DST starts at or before SRC, or the blocks do not overlap,
+   a forward copy is safe and memcpy() does it.  Otherwise the
+   copy runs backward: the odd bytes at the end first, then whole
+   words with REP MOVSL and the direction flag set, which must be
+   clear again before returning. */
 void *
 memmove (void *dst_, const void *src_, size_t size) 
 {
   unsigned char *dst = dst_;
   const unsigned char *src = src_;
+  size_t word_cnt;
 
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  if (dst < src) 
-    {
-      while (size-- > 0)
-        *dst++ = *src++;
-    }
-  else 
+  if (dst <= src || dst >= src + size)
+    return memcpy (dst_, src_, size);
+
+  dst += size;
+  src += size;
+  for (; size % sizeof (word_t) != 0; size--)
+    *--dst = *--src;
+
+  word_cnt = size / sizeof (word_t);
+  if (word_cnt > 0) 
     {
-      dst += size;
-      src += size;
-      while (size-- > 0)
-        *--dst = *--src;
+      dst -= sizeof (word_t);
+      src -= sizeof (word_t);
+      asm volatile ("std; rep movsl; cld"
+                    : "+D" (dst), "+S" (src), "+c" (word_cnt)
+                    : : "memory");
     }
 
-  return dst;
+  return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -78,6 +153,22 @@ strcmp (const char *a_, const char *b_)
   ASSERT (a != NULL);
   ASSERT (b != NULL);
 
+  /* If A and B are equally misaligned, compare a word at a time
+     once they are aligned, until the words differ or contain the
+     end of A.  The bytes loop then finds the exact position. */
+  if ((uintptr_t) a % sizeof (word_t) == (uintptr_t) b % sizeof (word_t)) 
+    {
+      for (; !is_aligned (a); a++, b++)
+        if (*a == '\0' || *a != *b)
+          return *a < *b ? -1 : *a > *b;
+      while (*(const word_t *) a == *(const word_t *) b
+             && !has_zero (*(const word_t *) a)) 
+        {
+          a += sizeof (word_t);
+          b += sizeof (word_t);
+        }
+    }
+
   while (*a != '\0' && *a == *b) 
     {
       a++;
@@ -113,9 +204,20 @@ char *
 strchr (const char *string, int c_) 
 {
   char c = c_;
+  word_t mask = (unsigned char) c * 0x01010101u;
 
   ASSERT (string != NULL);
 
+  /* Skip words that contain neither C nor the null terminator. */
+  for (; !is_aligned (string); string++)
+    if (*string == c)
+      return (char *) string;
+    else if (*string == '\0')
+      return NULL;
+  while (!has_zero (*(const word_t *) string)
+         && !has_zero (*(const word_t *) string ^ mask))
+    string += sizeof (word_t);
+
   for (;;) 
     if (*string == c)
       return (char *) string;
@@ -198,6 +300,15 @@ strstr (const char *haystack, const char *needle)
   return NULL;
 }
 
+/* Returns true if character C is in SET, a bitmap with one bit
+   for each of the 256 possible characters. */
+static inline bool
+in_set (const uint32_t set[256 / 32], char c_) 
+{
+  unsigned char c = c_;
+  return (set[c / 32] & (1u << (c % 32))) != 0;
+}
+
 /* Breaks a string into tokens separated by DELIMITERS.  The
    first time this function is called, S should be the string to
    tokenize, and in subsequent calls it must be a null pointer.
@@ -234,6 +345,8 @@ strstr (const char *haystack, const char *needle)
 char *
 strtok_r (char *s, const char *delimiters, char **save_ptr) 
 {
+  uint32_t set[256 / 32];
+  const unsigned char *d;
   char *token;
   
   ASSERT (delimiters != NULL);
@@ -245,12 +358,19 @@ strtok_r (char *s, const char *delimiters, char **save_ptr)
     s = *save_ptr;
   ASSERT (s != NULL);
 
+  /* Put DELIMITERS in a bitmap, so that testing each character
+     of S is a lookup rather than a scan of DELIMITERS.  The null
+     byte is always in the set, since it ends every token. */
+  memset (set, 0, sizeof set);
+  set[0] = 1;
+  for (d = (const unsigned char *) delimiters; *d != '\0'; d++)
+    set[*d / 32] |= 1u << (*d % 32);
+
   /* Skip any DELIMITERS at our current position. */
-  while (strchr (delimiters, *s) != NULL) 
+  while (in_set (set, *s)) 
     {
-      /* strchr() will always return nonnull if we're searching
-         for a null byte, because every string contains a null
-         byte (at the end). */
+      /* The null byte is always a delimiter, so we must check
+         for the end of the string here. */
       if (*s == '\0')
         {
           *save_ptr = s;
@@ -262,7 +382,7 @@ strtok_r (char *s, const char *delimiters, char **save_ptr)
 
   /* Skip any non-DELIMITERS up to the end of the string. */
   token = s;
-  while (strchr (delimiters, *s) == NULL)
+  while (!in_set (set, *s))
     s++;
   if (*s != '\0') 
     {
@@ -274,14 +394,43 @@ strtok_r (char *s, const char *delimiters, char **save_ptr)
   return token;
 }
 
-/* Sets the SIZE bytes in DST to VALUE. */
+/* Sets the SIZE bytes in DST to VALUE.  Returns DST.
+
+   Like memcpy(), this fills a word at a time once DST is aligned,
+   with REP STOSL for large blocks such as whole pages. */
 void *
 memset (void *dst_, int value, size_t size) 
 {
   unsigned char *dst = dst_;
 
   ASSERT (dst != NULL || size == 0);
-  
+
+  if (size >= 2 * sizeof (word_t)) 
+    {
+      word_t word = (unsigned char) value * 0x01010101u;
+      size_t word_cnt;
+
+      while ((uintptr_t) dst % sizeof (word_t) != 0) 
+        {
+          *dst++ = value;
+          size--;
+        }
+
+      word_cnt = size / sizeof (word_t);
+      size %= sizeof (word_t);
+      if (word_cnt * sizeof (word_t) >= REP_MIN)
+        asm volatile ("rep stosl"
+                      : "+D" (dst), "+c" (word_cnt)
+                      : "a" (word)
+                      : "memory");
+      else
+        for (; word_cnt > 0; word_cnt--) 
+          {
+            *(word_t *) dst = word;
+            dst += sizeof (word_t);
+          }
+    }
+
   while (size-- > 0)
     *dst++ = value;
 
@@ -296,7 +445,12 @@ strlen (const char *string)
 
   ASSERT (string != NULL);
 
-  for (p = string; *p != '\0'; p++)
+  for (p = string; !is_aligned (p); p++)
+    if (*p == '\0')
+      return p - string;
+  while (!has_zero (*(const word_t *) p))
+    p += sizeof (word_t);
+  for (; *p != '\0'; p++)
     continue;
   return p - string;
 }
@@ -308,7 +462,15 @@ strnlen (const char *string, size_t maxlen)
 {
   size_t length;
 
-  for (length = 0; string[length] != '\0' && length < maxlen; length++)
+  /* Only whole words that lie within the first MAXLEN bytes are
+     read, so STRING need not be accessible past them. */
+  for (length = 0; length < maxlen && !is_aligned (string + length); length++)
+    if (string[length] == '\0')
+      return length;
+  while (maxlen - length >= sizeof (word_t)
+         && !has_zero (*(const word_t *) (string + length)))
+    length += sizeof (word_t);
+  for (; length < maxlen && string[length] != '\0'; length++)
     continue;
   return length;
 }
@@ -28,7 +28,24 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_PREAD,                  /* Read from a file at a given offset. */
+    SYS_PWRITE,                 /* Write to a file at a given offset. */
+    SYS_READV,                  /* Read from a file into several buffers. */
+    SYS_WRITEV,                 /* Write to a file from several buffers. */
+    SYS_COPY_FILE_RANGE,        /* Copy data between files in the kernel. */
+    SYS_URING_SETUP,            /* Register a system call ring. */
+    SYS_URING_ENTER,            /* Run operations queued in the ring. */
+    SYS_AIO_READ,               /* Start reading a file. */
+    SYS_AIO_WRITE,              /* Start writing a file. */
+    SYS_AIO_WAIT,               /* Wait for asynchronous I/O to finish. */
+    SYS_AIO_POLL,               /* Find finished asynchronous I/O. */
+    SYS_PIPE,                   /* Create a pipe. */
+    SYS_SBRK,                   /* Move the program break. */
+    SYS_TTY_MODE,               /* Set console input mode. */
+    SYS_POLL                    /* Wait for descriptors to be ready. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,64 @@
+#ifndef __LIB_URING_H
+#define __LIB_URING_H
+
+#include <stdint.h>
+
+/* Submission and completion rings for batching system calls.
+
+   A process registers one page-aligned `struct uring' in its own
+   memory with uring_setup(), which resets all four indexes.  To
+   submit operations, it fills sq[sq_tail % URING_ENTRIES] and
+   increments sq_tail, once per operation, then calls
+   uring_enter().  The kernel consumes entries from sq_head,
+   running each in order, and posts one completion per entry at
+   cq[cq_tail % URING_ENTRIES].  The process reads completions from
+   cq_head, incrementing it as it goes.
+
+   The kernel never posts more completions than there is room for
+   in the completion ring, so entries stay queued until the
+   process catches up. */
+
+/* Entries in each ring.  Must be a power of 2. */
+#define URING_ENTRIES 64
+
+/* Operations. */
+enum uring_op
+  {
+    URING_NOP,                  /* Does nothing, completes with 0. */
+    URING_READ,                 /* read (fd, addr, len). */
+    URING_WRITE,                /* write (fd, addr, len). */
+    URING_SEEK,                 /* seek (fd, len), completes with 0. */
+    URING_OPEN,                 /* open (addr), completes with fd. */
+    URING_CLOSE                 /* close (fd), completes with 0. */
+  };
+
+/* Submission queue entry. */
+struct uring_sqe
+  {
+    uint32_t op;                /* An enum uring_op. */
+    int32_t fd;                 /* File descriptor. */
+    void *addr;                 /* Buffer or file name. */
+    uint32_t len;               /* Buffer length or file position. */
+    uint32_t user_data;         /* Copied to the completion. */
+  };
+
+/* Completion queue entry. */
+struct uring_cqe
+  {
+    uint32_t user_data;         /* From the submission. */
+    int32_t res;                /* Result, as the system call returns. */
+  };
+
+/* Both rings.  Indexes increase without bound and are reduced
+   modulo URING_ENTRIES to find a slot. */
+struct uring
+  {
+    uint32_t sq_head;           /* Next entry the kernel consumes. */
+    uint32_t sq_tail;           /* Next entry the process fills. */
+    uint32_t cq_head;           /* Next completion the process reads. */
+    uint32_t cq_tail;           /* Next completion the kernel posts. */
+    struct uring_sqe sq[URING_ENTRIES];
+    struct uring_cqe cq[URING_ENTRIES];
+  };
+
+#endif /* lib/uring.h */
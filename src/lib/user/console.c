@@ -3,6 +3,63 @@
 #include <syscall.h>
 #include <syscall-nr.h>
 
+/* Buffered I/O.
+
+   Output to a handle that has a buffer collects there until the
+   buffer fills, or, for a line-buffered handle, until a new-line
+   is written, and then goes out in a single write() system call.
+   The standard output starts out line-buffered; other handles
+   are unbuffered unless hsetvbuf() says otherwise.
+
+   Input read with hgetc() and hgetline() is read ahead into a
+   buffer, so that reading a line costs one system call instead
+   of one per character.
+
+   Buffers are tied to handles, not to files, so closing or
+   seeking a handle through the system call wrappers flushes its
+   output and discards its input, and closing it also frees its
+   buffers.  Mixing buffered and direct
+   I/O on one handle otherwise needs an explicit fflush(). */
+
+/* Number of handles that can have output buffers at once. */
+#define OUT_CNT 4
+
+/* Number of handles that can have input buffers at once. */
+#define IN_CNT 2
+
+/* Size of each buffer. */
+#define BUF_SIZE 512
+
+/* An output buffer. */
+struct out_buf
+  {
+    int handle;                 /* Handle, or -1 if buffer is free. */
+    int mode;                   /* _IOLBF or _IOFBF. */
+    size_t len;                 /* Number of bytes in BUF. */
+    char buf[BUF_SIZE];         /* Pending output. */
+  };
+
+/* An input buffer. */
+struct in_buf
+  {
+    int handle;                 /* Handle, or -1 if buffer is free. */
+    size_t pos;                 /* Next byte to return from BUF. */
+    size_t len;                 /* Number of bytes in BUF. */
+    char buf[BUF_SIZE];         /* Data read ahead. */
+  };
+
+static struct out_buf out_bufs[OUT_CNT] =
+  {
+    {STDOUT_FILENO, _IOLBF, 0, {0}}, {-1, 0, 0, {0}},
+    {-1, 0, 0, {0}}, {-1, 0, 0, {0}},
+  };
+static struct in_buf in_bufs[IN_CNT] = {{-1, 0, 0, {0}}, {-1, 0, 0, {0}}};
+
+static struct out_buf *find_out_buf (int handle);
+static struct in_buf *find_in_buf (int handle, bool create);
+static void out_flush (struct out_buf *);
+static void out_char (struct out_buf *, char);
+
 /* The standard vprintf() function,
    which is like printf() but uses a va_list. */
 int
@@ -30,8 +87,19 @@ hprintf (int handle, const char *format, ...)
 int
 puts (const char *s) 
 {
-  write (STDOUT_FILENO, s, strlen (s));
-  putchar ('\n');
+  struct out_buf *ob = find_out_buf (STDOUT_FILENO);
+
+  if (ob != NULL)
+    {
+      for (; *s != '\0'; s++)
+        out_char (ob, *s);
+      out_char (ob, '\n');
+    }
+  else
+    {
+      write (STDOUT_FILENO, s, strlen (s));
+      putchar ('\n');
+    }
 
   return 0;
 }
@@ -40,11 +108,174 @@ puts (const char *s)
 int
 putchar (int c) 
 {
-  char c2 = c;
-  write (STDOUT_FILENO, &c2, 1);
+  struct out_buf *ob = find_out_buf (STDOUT_FILENO);
+
+  if (ob != NULL)
+    out_char (ob, c);
+  else
+    {
+      char c2 = c;
+      write (STDOUT_FILENO, &c2, 1);
+    }
   return c;
 }
-
+
+/* Sets the buffering of output to HANDLE to MODE, one of
+   _IONBF, _IOLBF, or _IOFBF, flushing anything already
+   buffered.  Returns 0 if successful, -1 if every buffer is in
+   use or MODE is invalid. */
+int
+hsetvbuf (int handle, int mode) 
+{
+  struct out_buf *ob = find_out_buf (handle);
+
+  if (mode != _IONBF && mode != _IOLBF && mode != _IOFBF)
+    return -1;
+  if (ob != NULL)
+    {
+      out_flush (ob);
+      if (mode == _IONBF)
+        ob->handle = -1;
+      else
+        ob->mode = mode;
+      return 0;
+    }
+  if (mode == _IONBF)
+    return 0;
+
+  for (ob = out_bufs; ob < out_bufs + OUT_CNT; ob++)
+    if (ob->handle == -1)
+      {
+        ob->handle = handle;
+        ob->mode = mode;
+        ob->len = 0;
+        return 0;
+      }
+  return -1;
+}
+
+/* Writes out any output buffered for HANDLE.  Returns 0. */
+int
+fflush (int handle) 
+{
+  struct out_buf *ob = find_out_buf (handle);
+  if (ob != NULL)
+    out_flush (ob);
+  return 0;
+}
+
+/* Returns the next byte read from HANDLE, or EOF at end of file
+   or on error.  Output buffered for the standard output is
+   flushed before waiting for console input, so that prompts
+   appear. */
+int
+hgetc (int handle) 
+{
+  struct in_buf *ib;
+  unsigned char c;
+  int bytes_read;
+
+  /* A console read returns at most one line, so reading ahead
+     never waits for more than the caller asked for. */
+  ib = find_in_buf (handle, true);
+  if (handle == STDIN_FILENO && (ib == NULL || ib->pos >= ib->len))
+    fflush (STDOUT_FILENO);
+  if (ib == NULL)
+    return read (handle, &c, 1) == 1 ? c : EOF;
+  if (ib->pos >= ib->len)
+    {
+      bytes_read = read (handle, ib->buf, sizeof ib->buf);
+      ib->pos = 0;
+      ib->len = bytes_read > 0 ? bytes_read : 0;
+      if (ib->len == 0)
+        return EOF;
+    }
+  return (unsigned char) ib->buf[ib->pos++];
+}
+
+/* Returns the next byte from the standard input, or EOF. */
+int
+getchar (void) 
+{
+  return hgetc (STDIN_FILENO);
+}
+
+/* Reads a line from HANDLE into LINE, which has room for SIZE
+   bytes, through hgetc().  The line is null-terminated and
+   includes its new-line character, if there was one and there
+   was room for it.  Returns the number of bytes stored, not
+   counting the null terminator, or -1 if end of file came before
+   any byte was read. */
+int
+hgetline (int handle, char *line, size_t size) 
+{
+  size_t len = 0;
+
+  if (size == 0)
+    return -1;
+  while (len < size - 1)
+    {
+      int c = hgetc (handle);
+      if (c == EOF)
+        break;
+      line[len++] = c;
+      if (c == '\n')
+        break;
+    }
+  line[len] = '\0';
+  return len == 0 && size > 1 ? -1 : (int) len;
+}
+
+/* Writes out any output buffered for HANDLE and discards any
+   input read ahead from it.  seek() calls this before the file
+   position of HANDLE changes. */
+void
+__stdio_sync (int handle) 
+{
+  struct in_buf *ib = find_in_buf (handle, false);
+
+  fflush (handle);
+  if (ib != NULL)
+    ib->handle = -1;
+}
+
+/* Writes out any output buffered for HANDLE and returns the
+   number of bytes read ahead from it that have not been consumed
+   yet.  tell() subtracts this from the kernel's file position. */
+size_t
+__stdio_unread (int handle) 
+{
+  struct in_buf *ib = find_in_buf (handle, false);
+
+  fflush (handle);
+  return ib != NULL ? ib->len - ib->pos : 0;
+}
+
+/* Writes out any output buffered for HANDLE and frees its
+   buffers, so that a handle later opened with the same number
+   starts out unbuffered.  Called by close(). */
+void
+__stdio_close (int handle) 
+{
+  struct out_buf *ob = find_out_buf (handle);
+
+  __stdio_sync (handle);
+  if (ob != NULL)
+    ob->handle = -1;
+}
+
+/* Writes out all buffered output.  Called by exit() and
+   halt(). */
+void
+__stdio_flush_all (void) 
+{
+  struct out_buf *ob;
+
+  for (ob = out_bufs; ob < out_bufs + OUT_CNT; ob++)
+    if (ob->handle != -1)
+      out_flush (ob);
+}
+
 /* Auxiliary data for vhprintf_helper(). */
 struct vhprintf_aux 
   {
@@ -52,6 +283,7 @@ struct vhprintf_aux
     char *p;            /* Current position in buffer. */
     int char_cnt;       /* Total characters written so far. */
     int handle;         /* Output file handle. */
+    struct out_buf *ob; /* Buffer for HANDLE, if any. */
   };
 
 static void add_char (char, void *);
@@ -67,21 +299,28 @@ vhprintf (int handle, const char *format, va_list args)
   aux.p = aux.buf;
   aux.char_cnt = 0;
   aux.handle = handle;
+  aux.ob = find_out_buf (handle);
   __vprintf (format, args, add_char, &aux);
   flush (&aux);
   return aux.char_cnt;
 }
 
 /* Adds C to the buffer in AUX, flushing it if the buffer fills
-   up. */
+   up.  If AUX's handle has an output buffer, C goes there
+   instead. */
 static void
 add_char (char c, void *aux_) 
 {
   struct vhprintf_aux *aux = aux_;
+  aux->char_cnt++;
+  if (aux->ob != NULL)
+    {
+      out_char (aux->ob, c);
+      return;
+    }
   *aux->p++ = c;
   if (aux->p >= aux->buf + sizeof aux->buf)
     flush (aux);
-  aux->char_cnt++;
 }
 
 /* Flushes the buffer in AUX. */
@@ -92,3 +331,57 @@ flush (struct vhprintf_aux *aux)
     write (aux->handle, aux->buf, aux->p - aux->buf);
   aux->p = aux->buf;
 }
+
+/* Returns the output buffer for HANDLE, or a null pointer if
+   output to HANDLE is unbuffered. */
+static struct out_buf *
+find_out_buf (int handle) 
+{
+  struct out_buf *ob;
+
+  for (ob = out_bufs; ob < out_bufs + OUT_CNT; ob++)
+    if (ob->handle == handle && handle != -1)
+      return ob;
+  return NULL;
+}
+
+/* Returns the input buffer for HANDLE.  If there is none and
+   CREATE is true, sets up a free one for it.  Returns a null
+   pointer if there is none and none was set up. */
+static struct in_buf *
+find_in_buf (int handle, bool create) 
+{
+  struct in_buf *ib;
+
+  for (ib = in_bufs; ib < in_bufs + IN_CNT; ib++)
+    if (ib->handle == handle && handle != -1)
+      return ib;
+  if (create)
+    for (ib = in_bufs; ib < in_bufs + IN_CNT; ib++)
+      if (ib->handle == -1)
+        {
+          ib->handle = handle;
+          ib->pos = ib->len = 0;
+          return ib;
+        }
+  return NULL;
+}
+
+/* Writes out the contents of OB. */
+static void
+out_flush (struct out_buf *ob) 
+{
+  if (ob->len > 0)
+    write (ob->handle, ob->buf, ob->len);
+  ob->len = 0;
+}
+
+/* Adds C to OB, writing OB out if it becomes full, or if C is a
+   new-line and OB is line-buffered. */
+static void
+out_char (struct out_buf *ob, char c) 
+{
+  ob->buf[ob->len++] = c;
+  if (ob->len >= sizeof ob->buf || (c == '\n' && ob->mode == _IOLBF))
+    out_flush (ob);
+}
@@ -0,0 +1,389 @@
+#include <stdlib.h>
+#include <round.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+
+/* User heap allocator.
+
+   The heap is one arena between the program break at the first
+   call and the current break, which grows and shrinks with
+   sbrk().  The arena is a sequence of chunks, each starting with
+   a `struct chunk' header that records its own size and the size
+   of the chunk before it, ending with a zero-size sentinel.
+
+   Small requests, up to SMALL_MAX bytes with the header, are
+   rounded up to a power of 2 and served from per-size-class free
+   lists, LIFO, so the block freed last is handed out next while
+   it is still in the cache.  A class's list is refilled by
+   carving a RUN_SIZE chunk of the arena into blocks.  Runs are
+   not given back.
+
+   Larger requests get a chunk of their own, found first-fit in a
+   list of free chunks.  Freed chunks are merged with free
+   neighbors, and a free chunk at the end of the arena of at least
+   TRIM_SIZE bytes is returned to the kernel. */
+
+/* Chunk header, which precedes every block. */
+struct chunk
+  {
+    size_t prev_size;           /* Size of preceding chunk, 0 if first. */
+    size_t size;                /* Size with header, plus flag bits. */
+  };
+
+/* Flag bits in `size'.  Sizes are multiples of 8. */
+#define IN_USE 1                /* Allocated, or the sentinel. */
+#define SMALL 2                 /* Block in a small-object run. */
+#define FLAGS 7
+
+/* A free chunk, which is kept in free_chunks. */
+struct free_chunk
+  {
+    struct chunk header;
+    struct free_chunk *prev;
+    struct free_chunk *next;
+  };
+
+/* A free small block, which is kept in its class's free list. */
+struct free_block
+  {
+    struct chunk header;
+    struct free_block *next;
+  };
+
+#define CLASS_CNT 8             /* Small size classes. */
+#define SMALL_MIN 16            /* Smallest class. */
+#define SMALL_MAX (SMALL_MIN << (CLASS_CNT - 1))
+#define RUN_SIZE 8192           /* Bytes of blocks per run. */
+#define SPLIT_MIN 64            /* Smallest chunk left over by a split. */
+#define GROW_MIN 16384          /* Least the arena grows by. */
+#define TRIM_SIZE 65536         /* Free tail returned to the kernel. */
+
+static struct free_block *classes[CLASS_CNT];
+static struct free_chunk *free_chunks;
+static struct chunk *sentinel;
+
+static void *large_alloc (size_t size);
+static void large_free (struct chunk *);
+static struct chunk *coalesce (struct chunk *);
+static bool arena_init (void);
+static bool arena_grow (size_t size);
+static void split (struct chunk *, size_t size);
+static void insert (struct chunk *);
+static void unlink_chunk (struct chunk *);
+
+/* Returns the size of chunk C. */
+static inline size_t
+chunk_size (const struct chunk *c)
+{
+  return c->size & ~(size_t) FLAGS;
+}
+
+/* Returns the chunk that follows C in the arena. */
+static inline struct chunk *
+next_chunk (struct chunk *c)
+{
+  return (struct chunk *) ((uint8_t *) c + chunk_size (c));
+}
+
+/* Returns the chunk that precedes C in the arena, which must
+   exist. */
+static inline struct chunk *
+prev_chunk (struct chunk *c)
+{
+  return (struct chunk *) ((uint8_t *) c - c->prev_size);
+}
+
+/* Returns the size class for a block of SIZE bytes, header
+   included, which must be at most SMALL_MAX. */
+static inline int
+size_class (size_t size)
+{
+  int class = 0;
+  while ((size_t) (SMALL_MIN << class) < size)
+    class++;
+  return class;
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+void *
+malloc (size_t size)
+{
+  struct free_block *b;
+  int class;
+
+  if (size > SIZE_MAX - sizeof (struct chunk) - FLAGS)
+    return NULL;
+  size = ROUND_UP (size + sizeof (struct chunk), 8);
+  if (size > SMALL_MAX)
+    return large_alloc (size);
+
+  class = size_class (size);
+  if (classes[class] == NULL)
+    {
+      /* Refill the class from a new run. */
+      size_t block_size = SMALL_MIN << class;
+      uint8_t *run = large_alloc (RUN_SIZE + sizeof (struct chunk));
+      size_t ofs;
+
+      if (run == NULL)
+        return NULL;
+      for (ofs = RUN_SIZE; ofs >= block_size; ofs -= block_size)
+        {
+          b = (struct free_block *) (run + ofs - block_size);
+          b->header.size = block_size | SMALL | IN_USE;
+          b->next = classes[class];
+          classes[class] = b;
+        }
+    }
+  b = classes[class];
+  classes[class] = b->next;
+  return &b->next;
+}
+
+/* Allocates and returns A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b)
+{
+  void *p;
+  size_t size;
+
+  if (b != 0 && a > SIZE_MAX / b)
+    return NULL;
+  size = a * b;
+  p = malloc (size);
+  if (p != NULL)
+    memset (p, 0, size);
+  return p;
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly moving
+   it in the process.  If successful, returns the new block; on
+   failure, returns a null pointer.  A call with null OLD_BLOCK is
+   equivalent to malloc(NEW_SIZE).  A call with zero NEW_SIZE is
+   equivalent to free(OLD_BLOCK). */
+void *
+realloc (void *old_block, size_t new_size)
+{
+  struct chunk *c;
+  size_t size, old_size;
+  void *new_block;
+
+  if (new_size == 0)
+    {
+      free (old_block);
+      return NULL;
+    }
+  if (old_block == NULL)
+    return malloc (new_size);
+  if (new_size > SIZE_MAX - sizeof (struct chunk) - FLAGS)
+    return NULL;
+
+  c = (struct chunk *) old_block - 1;
+  old_size = chunk_size (c);
+  size = ROUND_UP (new_size + sizeof (struct chunk), 8);
+  if (size <= old_size)
+    return old_block;
+
+  /* A large chunk can often grow into a free chunk after it. */
+  if ((c->size & SMALL) == 0)
+    {
+      struct chunk *next = next_chunk (c);
+      if ((next->size & IN_USE) == 0 && old_size + chunk_size (next) >= size)
+        {
+          unlink_chunk (next);
+          c->size = (old_size + chunk_size (next)) | IN_USE;
+          next_chunk (c)->prev_size = chunk_size (c);
+          split (c, size);
+          return old_block;
+        }
+    }
+
+  new_block = malloc (new_size);
+  if (new_block != NULL)
+    {
+      memcpy (new_block, old_block, old_size - sizeof (struct chunk));
+      free (old_block);
+    }
+  return new_block;
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p)
+{
+  struct chunk *c;
+
+  if (p == NULL)
+    return;
+  c = (struct chunk *) p - 1;
+  if (c->size & SMALL)
+    {
+      struct free_block *b = (struct free_block *) c;
+      int class = size_class (chunk_size (c));
+      b->next = classes[class];
+      classes[class] = b;
+    }
+  else
+    large_free (c);
+}
+
+/* Returns a new chunk of SIZE bytes, header included, from the
+   arena, growing it if necessary. */
+static void *
+large_alloc (size_t size)
+{
+  struct free_chunk *f;
+
+  if (sentinel == NULL && !arena_init ())
+    return NULL;
+  if (size < sizeof (struct free_chunk))
+    size = sizeof (struct free_chunk);
+
+  for (;;)
+    {
+      for (f = free_chunks; f != NULL; f = f->next)
+        if (chunk_size (&f->header) >= size)
+          {
+            struct chunk *c = &f->header;
+            unlink_chunk (c);
+            c->size |= IN_USE;
+            split (c, size);
+            return c + 1;
+          }
+      if (!arena_grow (size))
+        return NULL;
+    }
+}
+
+/* Frees large chunk C, and gives a big enough free tail of the
+   arena back to the kernel. */
+static void
+large_free (struct chunk *c)
+{
+  c = coalesce (c);
+  if (next_chunk (c) == sentinel && chunk_size (c) >= TRIM_SIZE)
+    {
+      /* C becomes the sentinel. */
+      size_t size = chunk_size (c);
+      c->size = IN_USE;
+      sentinel = c;
+      sbrk (-(intptr_t) size);
+    }
+  else
+    insert (c);
+}
+
+/* Marks chunk C free and merges it with any free neighbors,
+   which are taken off free_chunks.  Returns the merged chunk,
+   which is not on free_chunks either. */
+static struct chunk *
+coalesce (struct chunk *c)
+{
+  struct chunk *next = next_chunk (c);
+
+  c->size &= ~(size_t) IN_USE;
+  if ((next->size & IN_USE) == 0)
+    {
+      unlink_chunk (next);
+      c->size += chunk_size (next);
+    }
+  if (c->prev_size != 0 && (prev_chunk (c)->size & IN_USE) == 0)
+    {
+      struct chunk *prev = prev_chunk (c);
+      unlink_chunk (prev);
+      prev->size += chunk_size (c);
+      c = prev;
+    }
+  next_chunk (c)->prev_size = chunk_size (c);
+  return c;
+}
+
+/* Sets up an empty arena at the current program break. */
+static bool
+arena_init (void)
+{
+  uint8_t *brk = sbrk (0);
+  size_t pad = -(uintptr_t) brk & 7;
+
+  if (sbrk (pad + sizeof *sentinel) == (void *) -1)
+    return false;
+  sentinel = (struct chunk *) (brk + pad);
+  sentinel->prev_size = 0;
+  sentinel->size = IN_USE;
+  return true;
+}
+
+/* Grows the arena so that it ends in a free chunk of at least
+   SIZE bytes. */
+static bool
+arena_grow (size_t size)
+{
+  struct chunk *c = sentinel;
+  size_t grow = size;
+
+  /* A free chunk at the end only needs to be extended. */
+  if (c->prev_size != 0 && (prev_chunk (c)->size & IN_USE) == 0)
+    grow -= chunk_size (prev_chunk (c));
+  if (sbrk (ROUND_UP (grow, GROW_MIN)) != (void *) -1)
+    grow = ROUND_UP (grow, GROW_MIN);
+  else if (sbrk (grow) == (void *) -1)
+    return false;
+
+  /* The old sentinel's place starts a new free chunk. */
+  c->size = grow;
+  sentinel = next_chunk (c);
+  sentinel->prev_size = grow;
+  sentinel->size = IN_USE;
+  insert (coalesce (c));
+  return true;
+}
+
+/* Shrinks in-use chunk C to SIZE bytes if the rest is big enough
+   to be worth keeping as a free chunk. */
+static void
+split (struct chunk *c, size_t size)
+{
+  size_t rest = chunk_size (c) - size;
+  struct chunk *r;
+
+  if (rest < SPLIT_MIN)
+    return;
+  c->size = size | IN_USE;
+  r = next_chunk (c);
+  r->prev_size = size;
+  r->size = rest;
+  next_chunk (r)->prev_size = rest;
+  insert (r);
+}
+
+/* Adds free chunk C to free_chunks. */
+static void
+insert (struct chunk *c)
+{
+  struct free_chunk *f = (struct free_chunk *) c;
+
+  f->prev = NULL;
+  f->next = free_chunks;
+  if (free_chunks != NULL)
+    free_chunks->prev = f;
+  free_chunks = f;
+}
+
+/* Removes free chunk C from free_chunks. */
+static void
+unlink_chunk (struct chunk *c)
+{
+  struct free_chunk *f = (struct free_chunk *) c;
+
+  if (f->prev != NULL)
+    f->prev->next = f->next;
+  else
+    free_chunks = f->next;
+  if (f->next != NULL)
+    f->next->prev = f->prev;
+}
@@ -1,7 +1,28 @@
 #ifndef __LIB_USER_STDIO_H
 #define __LIB_USER_STDIO_H
 
+/* Returned by the input functions at end of file. */
+#define EOF (-1)
+
+/* Buffering modes for hsetvbuf(). */
+#define _IONBF 0                /* Unbuffered. */
+#define _IOLBF 1                /* Line buffered. */
+#define _IOFBF 2                /* Fully buffered. */
+
 int hprintf (int, const char *, ...) PRINTF_FORMAT (2, 3);
 int vhprintf (int, const char *, va_list) PRINTF_FORMAT (2, 0);
 
+/* Buffered I/O. */
+int hsetvbuf (int handle, int mode);
+int fflush (int handle);
+int hgetc (int handle);
+int getchar (void);
+int hgetline (int handle, char *, size_t);
+
+/* Internal functions, for the system call wrappers. */
+void __stdio_sync (int handle);
+size_t __stdio_unread (int handle);
+void __stdio_close (int handle);
+void __stdio_flush_all (void);
+
 #endif /* lib/user/stdio.h */
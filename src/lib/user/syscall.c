@@ -1,69 +1,143 @@
 #include <syscall.h>
+#include <stdint.h>
+#include <stdio.h>
 #include "../syscall-nr.h"
+#include "../shared-page.h"
+
+/* System calls enter the kernel through syscall_entry, which is
+   called with the syscall number and arguments already pushed.
+   It starts out as syscall_probe, which on the first call picks
+   syscall_sysenter if the CPU has SYSENTER and SYSEXIT, or
+   syscall_int otherwise.  Either way the kernel finds the number
+   and arguments at the user stack pointer, as it always has. */
+void syscall_probe (void);
+void syscall_sysenter (void);
+void syscall_int (void);
+void syscall_select (void);
+void (*syscall_entry) (void) = syscall_probe;
+
+asm (".text\n"
+     "syscall_probe:\n"
+     "  pushal\n"
+     "  call syscall_select\n"
+     "  popal\n"
+     "  jmp *syscall_entry\n"
+
+     /* Pop the return address into EDX, where SYSEXIT picks it
+        up, and pass the stack pointer in ECX. */
+     "syscall_sysenter:\n"
+     "  popl %edx\n"
+     "  movl %esp, %ecx\n"
+     "  sysenter\n"
+
+     "syscall_int:\n"
+     "  popl %edx\n"
+     "  int $0x30\n"
+     "  jmp *%edx\n");
+
+/* Sets syscall_entry according to the CPU's features.  Must agree
+   with cpu_has_sysenter() in the kernel, which enables SYSENTER
+   under the same conditions. */
+void
+syscall_select (void) 
+{
+  uint32_t eax = 1, ebx, ecx, edx;
+  unsigned family, model, stepping;
+
+  asm ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  family = (eax >> 8) & 0xf;
+  model = (eax >> 4) & 0xf;
+  stepping = eax & 0xf;
+  if ((edx & 0x800) != 0 && !(family == 6 && model < 3 && stepping < 3))
+    syscall_entry = syscall_sysenter;
+  else
+    syscall_entry = syscall_int;
+}
 
 /* Invokes syscall NUMBER, passing no arguments, and returns the
    return value as an `int'. */
-#define syscall0(NUMBER)                                        \
-        ({                                                      \
-          int retval;                                           \
-          asm volatile                                          \
-            ("pushl %[number]; int $0x30; addl $4, %%esp"       \
-               : "=a" (retval)                                  \
-               : [number] "i" (NUMBER)                          \
-               : "memory");                                     \
-          retval;                                               \
+#define syscall0(NUMBER)                                            \
+        ({                                                          \
+          int retval;                                               \
+          asm volatile                                              \
+            ("pushl %[number]; call *syscall_entry; addl $4, %%esp" \
+               : "=a" (retval)                                      \
+               : [number] "i" (NUMBER)                              \
+               : "memory", "ecx", "edx");                           \
+          retval;                                                   \
         })
 
 /* Invokes syscall NUMBER, passing argument ARG0, and returns the
    return value as an `int'. */
-#define syscall1(NUMBER, ARG0)                                           \
-        ({                                                               \
-          int retval;                                                    \
-          asm volatile                                                   \
-            ("pushl %[arg0]; pushl %[number]; int $0x30; addl $8, %%esp" \
-               : "=a" (retval)                                           \
-               : [number] "i" (NUMBER),                                  \
-                 [arg0] "g" (ARG0)                                       \
-               : "memory");                                              \
-          retval;                                                        \
-        })
-
-/* Invokes syscall NUMBER, passing arguments ARG0 and ARG1, and
-   returns the return value as an `int'. */
-#define syscall2(NUMBER, ARG0, ARG1)                            \
+#define syscall1(NUMBER, ARG0)                                  \
         ({                                                      \
           int retval;                                           \
           asm volatile                                          \
-            ("pushl %[arg1]; pushl %[arg0]; "                   \
-             "pushl %[number]; int $0x30; addl $12, %%esp"      \
+            ("pushl %[arg0]; pushl %[number]; "                 \
+             "call *syscall_entry; addl $8, %%esp"              \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
-                 [arg0] "r" (ARG0),                             \
-                 [arg1] "r" (ARG1)                              \
-               : "memory");                                     \
+                 [arg0] "g" (ARG0)                              \
+               : "memory", "ecx", "edx");                       \
           retval;                                               \
         })
 
+/* Invokes syscall NUMBER, passing arguments ARG0 and ARG1, and
+   returns the return value as an `int'. */
+#define syscall2(NUMBER, ARG0, ARG1)                                 \
+        ({                                                           \
+          int retval;                                                \
+          asm volatile                                               \
+            ("pushl %[arg1]; pushl %[arg0]; "                        \
+             "pushl %[number]; call *syscall_entry; addl $12, %%esp" \
+               : "=a" (retval)                                       \
+               : [number] "i" (NUMBER),                              \
+                 [arg0] "r" (ARG0),                                  \
+                 [arg1] "r" (ARG1)                                   \
+               : "memory", "ecx", "edx");                            \
+          retval;                                                    \
+        })
+
 /* Invokes syscall NUMBER, passing arguments ARG0, ARG1, and
    ARG2, and returns the return value as an `int'. */
-#define syscall3(NUMBER, ARG0, ARG1, ARG2)                      \
-        ({                                                      \
-          int retval;                                           \
-          asm volatile                                          \
-            ("pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "    \
-             "pushl %[number]; int $0x30; addl $16, %%esp"      \
-               : "=a" (retval)                                  \
-               : [number] "i" (NUMBER),                         \
-                 [arg0] "r" (ARG0),                             \
-                 [arg1] "r" (ARG1),                             \
-                 [arg2] "r" (ARG2)                              \
-               : "memory");                                     \
-          retval;                                               \
+#define syscall3(NUMBER, ARG0, ARG1, ARG2)                           \
+        ({                                                           \
+          int retval;                                                \
+          asm volatile                                               \
+            ("pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "         \
+             "pushl %[number]; call *syscall_entry; addl $16, %%esp" \
+               : "=a" (retval)                                       \
+               : [number] "i" (NUMBER),                              \
+                 [arg0] "r" (ARG0),                                  \
+                 [arg1] "r" (ARG1),                                  \
+                 [arg2] "r" (ARG2)                                   \
+               : "memory", "ecx", "edx");                            \
+          retval;                                                    \
+        })
+
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2,
+   and ARG3, and returns the return value as an `int'. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                     \
+        ({                                                           \
+          int retval;                                                \
+          asm volatile                                               \
+            ("pushl %[arg3]; pushl %[arg2]; "                        \
+             "pushl %[arg1]; pushl %[arg0]; "                        \
+             "pushl %[number]; call *syscall_entry; addl $20, %%esp" \
+               : "=a" (retval)                                       \
+               : [number] "i" (NUMBER),                              \
+                 [arg0] "r" (ARG0),                                  \
+                 [arg1] "r" (ARG1),                                  \
+                 [arg2] "r" (ARG2),                                  \
+                 [arg3] "r" (ARG3)                                   \
+               : "memory", "ecx", "edx");                            \
+          retval;                                                    \
         })
 
 void
 halt (void) 
 {
+  __stdio_flush_all ();
   syscall0 (SYS_HALT);
   NOT_REACHED ();
 }
@@ -71,6 +145,7 @@ halt (void)
 void
 exit (int status)
 {
+  __stdio_flush_all ();
   syscall1 (SYS_EXIT, status);
   NOT_REACHED ();
 }
@@ -126,18 +201,21 @@ write (int fd, const void *buffer, unsigned size)
 void
 seek (int fd, unsigned position) 
 {
+  __stdio_sync (fd);
   syscall2 (SYS_SEEK, fd, position);
 }
 
 unsigned
 tell (int fd) 
 {
-  return syscall1 (SYS_TELL, fd);
+  size_t unread = __stdio_unread (fd);
+  return syscall1 (SYS_TELL, fd) - unread;
 }
 
 void
 close (int fd)
 {
+  __stdio_close (fd);
   syscall1 (SYS_CLOSE, fd);
 }
 
@@ -182,3 +260,129 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+int
+pread (int fd, void *buffer, unsigned size, unsigned offset) 
+{
+  return syscall4 (SYS_PREAD, fd, buffer, size, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned size, unsigned offset) 
+{
+  return syscall4 (SYS_PWRITE, fd, buffer, size, offset);
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt) 
+{
+  return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt) 
+{
+  return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+copy_file_range (int fd_in, int fd_out, unsigned length) 
+{
+  return syscall3 (SYS_COPY_FILE_RANGE, fd_in, fd_out, length);
+}
+
+void *
+sbrk (intptr_t increment) 
+{
+  return (void *) syscall1 (SYS_SBRK, increment);
+}
+
+int
+brk (void *addr) 
+{
+  uint8_t *cur = sbrk (0);
+  return sbrk ((uint8_t *) addr - cur) == (void *) -1 ? -1 : 0;
+}
+
+int
+pipe (int fds[2]) 
+{
+  return syscall1 (SYS_PIPE, fds);
+}
+
+int
+tty_mode (int mode) 
+{
+  return syscall1 (SYS_TTY_MODE, mode);
+}
+
+int
+poll (struct pollfd *fds, unsigned nfds, int timeout) 
+{
+  return syscall3 (SYS_POLL, fds, nfds, timeout);
+}
+
+int
+uring_setup (struct uring *ring) 
+{
+  return syscall1 (SYS_URING_SETUP, ring);
+}
+
+int
+uring_enter (unsigned to_submit) 
+{
+  return syscall1 (SYS_URING_ENTER, to_submit);
+}
+
+int
+aio_read (int fd, void *buffer, unsigned size, unsigned offset) 
+{
+  return syscall4 (SYS_AIO_READ, fd, buffer, size, offset);
+}
+
+int
+aio_write (int fd, const void *buffer, unsigned size, unsigned offset) 
+{
+  return syscall4 (SYS_AIO_WRITE, fd, buffer, size, offset);
+}
+
+int
+aio_wait (int id) 
+{
+  return syscall1 (SYS_AIO_WAIT, id);
+}
+
+int
+aio_poll (void) 
+{
+  return syscall0 (SYS_AIO_POLL);
+}
+
+/* Returns the number of timer ticks since the OS booted.  Reads
+   the kernel's shared page, retrying if a timer interrupt
+   updated it in the middle of the read. */
+int64_t
+get_ticks (void) 
+{
+  const struct shared_page *sp = (const struct shared_page *) SHARED_PAGE_VADDR;
+  uint32_t seq;
+  int64_t ticks;
+
+  do 
+    {
+      seq = sp->seq;
+      asm volatile ("" : : : "memory");
+      ticks = sp->ticks;
+      asm volatile ("" : : : "memory");
+    }
+  while ((seq & 1) != 0 || seq != sp->seq);
+  return ticks;
+}
+
+/* Returns the number of timer ticks per second. */
+int
+get_timer_freq (void) 
+{
+  const struct shared_page *sp = (const struct shared_page *) SHARED_PAGE_VADDR;
+  return sp->timer_freq;
+}
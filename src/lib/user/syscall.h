@@ -2,7 +2,11 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <debug.h>
+#include <iovec.h>
+#include <uring.h>
+#include <poll.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -34,10 +38,63 @@ void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
 
+/* Heap.  sbrk() returns the old break, or (void *) -1 on failure;
+   brk() returns 0 on success, -1 on failure. */
+void *sbrk (intptr_t increment);
+int brk (void *addr);
+
 /* Project 3 and optionally project 4. */
 mapid_t mmap (int fd, void *addr);
 void munmap (mapid_t);
 
+/* Positional and vectored I/O. */
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int copy_file_range (int fd_in, int fd_out, unsigned length);
+
+/* Creates a pipe.  FDS[0] is its read end and FDS[1] its write
+   end.  Children started with exec() inherit pipe ends at the
+   same descriptors. */
+int pipe (int fds[2]);
+
+/* Console input modes for tty_mode().  In canonical mode, the
+   default, reading the standard input returns one line at a time,
+   edited and echoed by the kernel; Ctrl+D at the start of a line
+   reads as end of file.  In raw mode, reading returns whatever
+   bytes have been typed, without echo.  tty_mode() returns the
+   old mode, or -1 if MODE is invalid. */
+#define TTY_CANONICAL 0
+#define TTY_RAW 1
+int tty_mode (int mode);
+
+/* Waits until at least one of the NFDS descriptors in FDS is
+   ready for the events it asks for, or TIMEOUT milliseconds pass
+   (forever if TIMEOUT is negative).  Descriptor 0 is ready for
+   reading once a read would not wait.  Returns the number of
+   descriptors with events to report, 0 on timeout, or -1 if NFDS
+   is more than POLL_MAX. */
+int poll (struct pollfd *fds, unsigned nfds, int timeout);
+
+/* Batched system calls.  See lib/uring.h. */
+int uring_setup (struct uring *ring);
+int uring_enter (unsigned to_submit);
+
+/* Asynchronous I/O at explicit file offsets.  aio_read() and
+   aio_write() return a request id for aio_wait(), which returns
+   the byte count.  aio_poll() returns the id of a finished
+   request not yet waited for, or -1. */
+int aio_read (int fd, void *buffer, unsigned length, unsigned offset);
+int aio_write (int fd, const void *buffer, unsigned length, unsigned offset);
+int aio_wait (int id);
+int aio_poll (void);
+
+/* Read without a system call, from the page the kernel shares
+   with every process. */
+int64_t get_ticks (void);
+int get_timer_freq (void);
+
 /* Project 4 only. */
 bool chdir (const char *dir);
 bool mkdir (const char *dir);
@@ -1,4 +1,5 @@
-/* Test program for sorting and searching in lib/stdlib.c.
+/* Test program for sorting and searching in lib/stdlib.c,
+   including sort_uint32() and sort_bytes().
 
    Attempts to test the sorting and searching functionality that
    is not sufficiently tested elsewhere in Pintos.
@@ -11,6 +12,7 @@
 #include <debug.h>
 #include <limits.h>
 #include <random.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include "threads/test.h"
@@ -22,6 +24,8 @@ static void shuffle (int[], size_t);
 static int compare_ints (const void *, const void *);
 static void verify_order (const int[], size_t);
 static void verify_bsearch (const int[], size_t);
+static void test_sort_uint32 (size_t);
+static void test_sort_bytes (size_t);
 
 /* Test sorting and searching implementations. */
 void
@@ -49,6 +53,9 @@ test (void)
           qsort (values, cnt, sizeof *values, compare_ints);
           verify_order (values, cnt);
           verify_bsearch (values, cnt);
+
+          test_sort_uint32 (cnt);
+          test_sort_bytes (cnt);
         }
     }
   
@@ -112,3 +119,49 @@ verify_bsearch (const int *array, size_t cnt)
     ASSERT (bsearch (&not_in_array[i], array, cnt, sizeof *array, compare_ints)
             == NULL);
 }
+
+/* Checks sort_uint32() on CNT random values, with the same sum
+   before and after to catch lost or duplicated values. */
+static void
+test_sort_uint32 (size_t cnt) 
+{
+  static uint32_t values[MAX_CNT];
+  uint32_t sum_before = 0, sum_after = 0;
+  size_t i;
+
+  for (i = 0; i < cnt; i++) 
+    {
+      values[i] = random_ulong ();
+      sum_before += values[i];
+    }
+  sort_uint32 (values, cnt);
+  for (i = 0; i < cnt; i++) 
+    {
+      ASSERT (i == 0 || values[i - 1] <= values[i]);
+      sum_after += values[i];
+    }
+  ASSERT (sum_before == sum_after);
+}
+
+/* Checks sort_bytes() on CNT random bytes. */
+static void
+test_sort_bytes (size_t cnt) 
+{
+  static unsigned char bytes[MAX_CNT];
+  size_t counts[UCHAR_MAX + 1] = {0};
+  size_t i;
+
+  for (i = 0; i < cnt; i++) 
+    {
+      bytes[i] = random_ulong ();
+      counts[bytes[i]]++;
+    }
+  sort_bytes (bytes, cnt);
+  for (i = 0; i < cnt; i++) 
+    {
+      ASSERT (i == 0 || bytes[i - 1] <= bytes[i]);
+      counts[bytes[i]]--;
+    }
+  for (i = 0; i <= UCHAR_MAX; i++)
+    ASSERT (counts[i] == 0);
+}
@@ -0,0 +1,366 @@
+/* Test program for lib/string.c.
+
+   Checks memcpy(), memmove(), and memset() against simple byte
+   loops for every combination of small sizes and alignments,
+   plus some large blocks.  Checks strlen(), strnlen(), strcmp(),
+   and strchr() the same way on random strings at every
+   alignment, and strtok_r() on a few fixed strings.  Then times
+   the functions against the byte loops.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+#include "devices/timer.h"
+
+/* Size of the test buffers. */
+#define BUF_SIZE 8192
+
+/* Largest size for the exhaustive tests. */
+#define SMALL_MAX 72
+
+/* Times each function is run on a page for timing. */
+#define TIME_REPS 2000
+
+static unsigned char buf_a[BUF_SIZE], buf_b[BUF_SIZE], buf_c[BUF_SIZE];
+
+/* Results of timed calls go here, so they cannot be optimized
+   away. */
+static volatile size_t sink;
+
+static void byte_copy (unsigned char *, const unsigned char *, size_t);
+static void byte_move (unsigned char *, const unsigned char *, size_t);
+static void byte_set (unsigned char *, int, size_t);
+static void fill_random (unsigned char *, size_t);
+static void test_copy (size_t dst_ofs, size_t src_ofs, size_t size);
+static void test_move (size_t dst_ofs, size_t src_ofs, size_t size);
+static void test_set (size_t ofs, size_t size);
+static void time_mem (void);
+static size_t byte_strlen (const char *);
+static int byte_strcmp (const char *, const char *);
+static char *byte_strchr (const char *, int);
+static void random_string (char *, size_t length, int alphabet);
+static void test_str (size_t a_ofs, size_t b_ofs, size_t length);
+static void test_strtok (void);
+static void time_str (void);
+
+/* Test memory functions. */
+void
+test (void)
+{
+  size_t dst_ofs, src_ofs, size;
+
+  printf ("testing small blocks...");
+  for (size = 0; size <= SMALL_MAX; size++)
+    for (dst_ofs = 0; dst_ofs < 8; dst_ofs++)
+      {
+        for (src_ofs = 0; src_ofs < 8; src_ofs++)
+          {
+            test_copy (dst_ofs, src_ofs + 100, size);
+            test_move (dst_ofs + 16, src_ofs + 16, size);
+          }
+        test_set (dst_ofs, size);
+      }
+  printf (" done\n");
+
+  printf ("testing large blocks...");
+  for (size = 256; size <= BUF_SIZE / 2; size = size * 3 / 2 + 1)
+    {
+      test_copy (3, 1, size);
+      test_copy (0, BUF_SIZE / 2, size);
+      test_move (0, 5, size);
+      test_move (7, 0, size);
+      test_move (64, 0, size);
+      test_move (0, 64, size);
+      test_set (1, size);
+    }
+  printf (" done\n");
+
+  printf ("testing strings...");
+  for (size = 0; size <= SMALL_MAX; size++)
+    for (dst_ofs = 0; dst_ofs < 8; dst_ofs++)
+      for (src_ofs = 0; src_ofs < 8; src_ofs++)
+        test_str (dst_ofs, src_ofs, size);
+  test_strtok ();
+  printf (" done\n");
+
+  time_mem ();
+  time_str ();
+  printf ("string: PASS\n");
+}
+
+/* Checks memcpy() of SIZE bytes from offset SRC_OFS to offset
+   DST_OFS in separate buffers. */
+static void
+test_copy (size_t dst_ofs, size_t src_ofs, size_t size)
+{
+  fill_random (buf_a, BUF_SIZE);
+  fill_random (buf_b, BUF_SIZE);
+  byte_copy (buf_c, buf_b, BUF_SIZE);
+
+  ASSERT (memcpy (buf_b + dst_ofs, buf_a + src_ofs, size) == buf_b + dst_ofs);
+  byte_copy (buf_c + dst_ofs, buf_a + src_ofs, size);
+  ASSERT (!memcmp (buf_b, buf_c, BUF_SIZE));
+}
+
+/* Checks memmove() of SIZE bytes from offset SRC_OFS to offset
+   DST_OFS within a single buffer, so that they overlap. */
+static void
+test_move (size_t dst_ofs, size_t src_ofs, size_t size)
+{
+  fill_random (buf_a, BUF_SIZE);
+  byte_copy (buf_c, buf_a, BUF_SIZE);
+
+  ASSERT (memmove (buf_a + dst_ofs, buf_a + src_ofs, size) == buf_a + dst_ofs);
+  byte_move (buf_c + dst_ofs, buf_c + src_ofs, size);
+  ASSERT (!memcmp (buf_a, buf_c, BUF_SIZE));
+}
+
+/* Checks memset() of SIZE bytes at offset OFS. */
+static void
+test_set (size_t ofs, size_t size)
+{
+  int value = random_ulong () % 256;
+
+  fill_random (buf_a, BUF_SIZE);
+  byte_copy (buf_c, buf_a, BUF_SIZE);
+
+  ASSERT (memset (buf_a + ofs, value, size) == buf_a + ofs);
+  byte_set (buf_c + ofs, value, size);
+  ASSERT (!memcmp (buf_a, buf_c, BUF_SIZE));
+}
+
+/* Prints the timer ticks taken by TIME_REPS page-sized copies
+   and fills with the byte loops and with the library. */
+static void
+time_mem (void)
+{
+  int64_t start;
+  int i;
+
+  printf ("timing %d page-sized operations (ticks):\n", TIME_REPS);
+
+  start = timer_ticks ();
+  for (i = 0; i < TIME_REPS; i++)
+    byte_copy (buf_a, buf_b, 4096);
+  printf ("  byte copy %"PRId64",", timer_elapsed (start));
+  start = timer_ticks ();
+  for (i = 0; i < TIME_REPS; i++)
+    memcpy (buf_a, buf_b, 4096);
+  printf (" memcpy %"PRId64",", timer_elapsed (start));
+  start = timer_ticks ();
+  for (i = 0; i < TIME_REPS; i++)
+    memmove (buf_a + 4, buf_a, 4096);
+  printf (" memmove %"PRId64"\n", timer_elapsed (start));
+
+  start = timer_ticks ();
+  for (i = 0; i < TIME_REPS; i++)
+    byte_set (buf_a, 0, 4096);
+  printf ("  byte set %"PRId64",", timer_elapsed (start));
+  start = timer_ticks ();
+  for (i = 0; i < TIME_REPS; i++)
+    memset (buf_a, 0, 4096);
+  printf (" memset %"PRId64"\n", timer_elapsed (start));
+}
+
+/* Fills the SIZE bytes at P with random data. */
+static void
+fill_random (unsigned char *p, size_t size)
+{
+  random_bytes (p, size);
+}
+
+/* Reference byte-at-a-time copy, for non-overlapping blocks.
+   Volatile keeps the compiler from turning it into memcpy(). */
+static void
+byte_copy (unsigned char *dst, const unsigned char *src, size_t size)
+{
+  volatile unsigned char *d = dst;
+
+  while (size-- > 0)
+    *d++ = *src++;
+}
+
+/* Reference byte-at-a-time copy for overlapping blocks. */
+static void
+byte_move (unsigned char *dst, const unsigned char *src, size_t size)
+{
+  volatile unsigned char *d = dst;
+
+  if (dst < src)
+    while (size-- > 0)
+      *d++ = *src++;
+  else
+    while (size-- > 0)
+      d[size] = src[size];
+}
+
+/* Reference byte-at-a-time fill. */
+static void
+byte_set (unsigned char *dst, int value, size_t size)
+{
+  volatile unsigned char *d = dst;
+
+  while (size-- > 0)
+    *d++ = value;
+}
+
+/* Checks the string functions on random strings of LENGTH bytes
+   at offset A_OFS in buf_a and B_OFS in buf_b. */
+static void
+test_str (size_t a_ofs, size_t b_ofs, size_t length)
+{
+  char *a = (char *) buf_a + a_ofs;
+  char *b = (char *) buf_b + b_ofs;
+  size_t i;
+  int cmp;
+
+  /* B is a copy of A, maybe with one character changed, maybe
+     cut short, to exercise each way strcmp() can end. */
+  random_string (a, length, random_ulong () % 255 + 1);
+  byte_copy ((unsigned char *) b, (unsigned char *) a, length + 1);
+  if (length > 0 && random_ulong () % 2)
+    b[random_ulong () % length] = random_ulong () % 255 + 1;
+  if (length > 0 && random_ulong () % 4 == 0)
+    b[random_ulong () % length] = '\0';
+
+  ASSERT (strlen (a) == length);
+  ASSERT (strlen (b) == byte_strlen (b));
+  for (i = 0; i <= length + 1; i++)
+    ASSERT (strnlen (a, i) == (i < length ? i : length));
+  cmp = byte_strcmp (a, b);
+  ASSERT ((strcmp (a, b) > 0) == (cmp > 0));
+  ASSERT ((strcmp (a, b) < 0) == (cmp < 0));
+  for (i = 0; i <= length; i++)
+    ASSERT (strchr (a, a[i]) == byte_strchr (a, a[i]));
+  ASSERT (strchr (a, 0x100 + a[0]) == byte_strchr (a, a[0]));
+}
+
+/* Checks strtok_r() on strings with runs of delimiters, high
+   delimiter characters, and no tokens at all. */
+static void
+test_strtok (void)
+{
+  static const char *tokens[] = {"String", "to", "tokenize."};
+  char s1[] = "  String to  tokenize. ";
+  char s2[] = "a,b;;c\xe9" "d";
+  char s3[] = " ,, ";
+  char *token, *save_ptr;
+  int i;
+
+  for (token = strtok_r (s1, " ", &save_ptr), i = 0; token != NULL;
+       token = strtok_r (NULL, " ", &save_ptr), i++)
+    ASSERT (i < 3 && !strcmp (token, tokens[i]));
+  ASSERT (i == 3);
+
+  ASSERT (!strcmp (strtok_r (s2, ",;\xe9", &save_ptr), "a"));
+  ASSERT (!strcmp (strtok_r (NULL, ",;\xe9", &save_ptr), "b"));
+  ASSERT (!strcmp (strtok_r (NULL, ";", &save_ptr), "c\xe9" "d"));
+  ASSERT (strtok_r (NULL, ";", &save_ptr) == NULL);
+
+  ASSERT (strtok_r (s3, ", ", &save_ptr) == NULL);
+}
+
+/* Prints the timer ticks taken by the string functions and by
+   the byte loops on a page-long string. */
+static void
+time_str (void)
+{
+  /* Volatile, so that calls are not hoisted out of the loops. */
+  const char *volatile s = (char *) buf_a;
+  const char *volatile t = (char *) buf_b;
+  int64_t start;
+  int i;
+
+  random_string ((char *) buf_a, 4095, 255);
+  byte_copy (buf_b, buf_a, 4096);
+
+  printf ("timing %d page-long strings (ticks):\n", TIME_REPS);
+
+  start = timer_ticks ();
+  for (i = 0; i < TIME_REPS; i++)
+    sink += byte_strlen (s);
+  printf ("  byte strlen %"PRId64",", timer_elapsed (start));
+  start = timer_ticks ();
+  for (i = 0; i < TIME_REPS; i++)
+    sink += strlen (s);
+  printf (" strlen %"PRId64"\n", timer_elapsed (start));
+
+  start = timer_ticks ();
+  for (i = 0; i < TIME_REPS; i++)
+    sink += byte_strcmp (s, t);
+  printf ("  byte strcmp %"PRId64",", timer_elapsed (start));
+  start = timer_ticks ();
+  for (i = 0; i < TIME_REPS; i++)
+    sink += strcmp (s, t);
+  printf (" strcmp %"PRId64"\n", timer_elapsed (start));
+
+  start = timer_ticks ();
+  for (i = 0; i < TIME_REPS; i++)
+    sink += byte_strchr (s, '\0') != NULL;
+  printf ("  byte strchr %"PRId64",", timer_elapsed (start));
+  start = timer_ticks ();
+  for (i = 0; i < TIME_REPS; i++)
+    sink += strchr (s, '\0') != NULL;
+  printf (" strchr %"PRId64"\n", timer_elapsed (start));
+}
+
+/* Stores a random null-terminated string of LENGTH characters
+   in S, with characters drawn from 1...ALPHABET. */
+static void
+random_string (char *s, size_t length, int alphabet)
+{
+  size_t i;
+
+  for (i = 0; i < length; i++)
+    s[i] = random_ulong () % alphabet + 1;
+  s[length] = '\0';
+}
+
+/* Reference byte-at-a-time strlen(). */
+static size_t
+byte_strlen (const char *s)
+{
+  const volatile char *p = s;
+
+  while (*p != '\0')
+    p++;
+  return p - s;
+}
+
+/* Reference byte-at-a-time strcmp(). */
+static int
+byte_strcmp (const char *a_, const char *b_)
+{
+  const volatile unsigned char *a = (const unsigned char *) a_;
+  const volatile unsigned char *b = (const unsigned char *) b_;
+
+  while (*a != '\0' && *a == *b)
+    {
+      a++;
+      b++;
+    }
+  return *a < *b ? -1 : *a > *b;
+}
+
+/* Reference byte-at-a-time strchr(). */
+static char *
+byte_strchr (const char *s, int c_)
+{
+  const volatile char *p = s;
+  char c = c_;
+
+  for (;; p++)
+    if (*p == c)
+      return (char *) p;
+    else if (*p == '\0')
+      return NULL;
+}
@@ -0,0 +1,38 @@
+/* Reads sample.txt and writes a copy of it with asynchronous
+   I/O, using a buffer that straddles a page boundary. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[8192];
+
+void
+test_main (void) 
+{
+  char *p = buf + 4096 - 100;
+  int in_fd, out_fd, id, done;
+
+  CHECK ((in_fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((id = aio_read (in_fd, p, sizeof sample - 1, 0)) >= 0, "aio_read");
+
+  /* Nothing may be done with the buffer until the read completes,
+     but the process can do anything else. */
+  while ((done = aio_poll ()) == -1)
+    continue;
+  CHECK (done == id, "aio_poll found the read");
+  CHECK (aio_wait (id) == sizeof sample - 1, "aio_wait read");
+  if (memcmp (p, sample, sizeof sample - 1))
+    fail ("aio_read returned wrong data");
+  CHECK (aio_wait (id) == -1, "second aio_wait fails");
+
+  CHECK (create ("copy", sizeof sample - 1), "create \"copy\"");
+  CHECK ((out_fd = open ("copy")) > 1, "open \"copy\"");
+  CHECK ((id = aio_write (out_fd, p, sizeof sample - 1, 0)) >= 0, "aio_write");
+  close (out_fd);
+  CHECK (aio_wait (id) == sizeof sample - 1, "aio_wait write");
+  check_file ("copy", sample, sizeof sample - 1);
+  CHECK (aio_read (0, p, 1, 0) == -1, "aio_read from console fails");
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(aio-rw) begin
+(aio-rw) open "sample.txt"
+(aio-rw) aio_read
+(aio-rw) aio_poll found the read
+(aio-rw) aio_wait read
+(aio-rw) second aio_wait fails
+(aio-rw) create "copy"
+(aio-rw) open "copy"
+(aio-rw) aio_write
+(aio-rw) aio_wait write
+(aio-rw) open "copy" for verification
+(aio-rw) verified contents of "copy"
+(aio-rw) close "copy"
+(aio-rw) aio_read from console fails
+(aio-rw) end
+aio-rw: exit(0)
+EOF
+pass;
@@ -0,0 +1,28 @@
+/* Child process run by pipe-child test.
+
+   Writes PIPE_CHILD_SIZE bytes of a pattern to the pipe write end
+   whose descriptor is the first command-line argument, which it
+   inherited from its parent. */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/userprog/pipe-child.h"
+
+const char *test_name = "child-pipe";
+
+int
+main (int argc UNUSED, char *argv[]) 
+{
+  static char buf[PIPE_CHILD_SIZE];
+  size_t i;
+
+  if (!isdigit (*argv[1]))
+    fail ("bad command-line arguments");
+  for (i = 0; i < sizeof buf; i++)
+    buf[i] = i % 251;
+  if (write (atoi (argv[1]), buf, sizeof buf) != sizeof buf)
+    fail ("write failed");
+  return 0;
+}
@@ -0,0 +1,24 @@
+/* Copies sample.txt into a new file inside the kernel and checks
+   the copy. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int in_fd, out_fd;
+
+  CHECK (create ("copy", sizeof sample - 1), "create \"copy\"");
+  CHECK ((in_fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((out_fd = open ("copy")) > 1, "open \"copy\"");
+  CHECK (copy_file_range (in_fd, out_fd, sizeof sample - 1)
+         == sizeof sample - 1, "copy_file_range");
+  CHECK (tell (in_fd) == sizeof sample - 1, "source position advanced");
+  CHECK (copy_file_range (in_fd, out_fd, 10) == 0, "copy at end of file");
+  CHECK (copy_file_range (in_fd, 1, 10) == -1, "copy to console fails");
+  close (out_fd);
+  check_file ("copy", sample, sizeof sample - 1);
+}
@@ -0,0 +1,23 @@
+/* Reads the timer through the page shared with the kernel and
+   waits for it to advance, without making any system call. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int64_t start, now;
+
+  CHECK (get_timer_freq () > 0, "timer frequency is positive");
+  start = get_ticks ();
+  do
+    {
+      now = get_ticks ();
+      if (now < start)
+        fail ("ticks went backward");
+    }
+  while (now == start);
+  msg ("ticks advance");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(get-ticks) begin
+(get-ticks) timer frequency is positive
+(get-ticks) ticks advance
+(get-ticks) end
+get-ticks: exit(0)
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Opens more files than fit in one page of pointers, closes
+   every other one, and checks that reopening fills the holes
+   lowest first. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 1500
+
+static int fds[FILE_CNT];
+
+void
+test_main (void) 
+{
+  int i;
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      fds[i] = open ("sample.txt");
+      if (fds[i] < 2)
+        fail ("open #%d failed", i);
+      if (i > 0 && fds[i] != fds[i - 1] + 1)
+        fail ("open #%d returned %d after %d", i, fds[i], fds[i - 1]);
+    }
+  msg ("opened %d files", FILE_CNT);
+
+  for (i = 0; i < FILE_CNT; i += 2)
+    close (fds[i]);
+  msg ("closed every other file");
+
+  for (i = 0; i < FILE_CNT; i += 2)
+    if (open ("sample.txt") != fds[i])
+      fail ("reopen did not return %d", fds[i]);
+  msg ("reopened into the lowest free fds");
+
+  for (i = 0; i < FILE_CNT; i++)
+    close (fds[i]);
+}
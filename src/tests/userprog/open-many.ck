@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(open-many) begin
+(open-many) opened 1500 files
+(open-many) closed every other file
+(open-many) reopened into the lowest free fds
+(open-many) end
+open-many: exit(0)
+EOF
+pass;
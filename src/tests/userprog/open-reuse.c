@@ -0,0 +1,26 @@
+/* Opens three handles, closes the middle one, and checks that
+   the next open reuses its number while the others keep
+   theirs. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int a, b, c, d;
+  char byte;
+
+  CHECK ((a = open ("sample.txt")) > 1, "open \"sample.txt\" once");
+  CHECK ((b = open ("sample.txt")) > 1, "open \"sample.txt\" twice");
+  CHECK ((c = open ("sample.txt")) > 1, "open \"sample.txt\" three times");
+  if (a == b || b == c || a == c)
+    fail ("open returned the same fd twice");
+
+  msg ("close second handle");
+  close (b);
+  CHECK ((d = open ("sample.txt")) == b, "open \"sample.txt\" reuses fd");
+  CHECK (read (c, &byte, 1) == 1, "third handle still reads");
+  CHECK (read (a, &byte, 1) == 1, "first handle still reads");
+}
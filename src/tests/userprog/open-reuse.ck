@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(open-reuse) begin
+(open-reuse) open "sample.txt" once
+(open-reuse) open "sample.txt" twice
+(open-reuse) open "sample.txt" three times
+(open-reuse) close second handle
+(open-reuse) open "sample.txt" reuses fd
+(open-reuse) third handle still reads
+(open-reuse) first handle still reads
+(open-reuse) end
+open-reuse: exit(0)
+EOF
+pass;
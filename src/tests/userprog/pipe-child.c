@@ -0,0 +1,37 @@
+/* Runs a child that inherits a pipe and writes more through it
+   than the pipe can hold, and reads it all back. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/userprog/pipe-child.h"
+
+void
+test_main (void) 
+{
+  char child_cmd[128];
+  char buf[1000];
+  size_t total = 0;
+  pid_t child;
+  int fds[2];
+  int n;
+
+  CHECK (pipe (fds) == 0, "pipe");
+  snprintf (child_cmd, sizeof child_cmd, "child-pipe %d", fds[1]);
+  CHECK ((child = exec (child_cmd)) != -1, "exec \"%s\"", child_cmd);
+  close (fds[1]);
+
+  while ((n = read (fds[0], buf, sizeof buf)) > 0) 
+    {
+      int i;
+      for (i = 0; i < n; i++, total++)
+        if (buf[i] != (char) (total % 251))
+          fail ("byte %zu is wrong", total);
+    }
+  CHECK (n == 0, "end of file");
+  if (total != PIPE_CHILD_SIZE)
+    fail ("read %zu bytes, expected %d", total, PIPE_CHILD_SIZE);
+  msg ("read all data");
+  CHECK (wait (child) == 0, "wait for child");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-child) begin
+(pipe-child) pipe
+(pipe-child) exec "child-pipe 3"
+child-pipe: exit(0)
+(pipe-child) end of file
+(pipe-child) read all data
+(pipe-child) wait for child
+(pipe-child) end
+pipe-child: exit(0)
+EOF
+pass;
@@ -0,0 +1,7 @@
+#ifndef TESTS_USERPROG_PIPE_CHILD_H
+#define TESTS_USERPROG_PIPE_CHILD_H
+
+/* Bytes child-pipe writes, more than a pipe holds at once. */
+#define PIPE_CHILD_SIZE 40000
+
+#endif /* tests/userprog/pipe-child.h */
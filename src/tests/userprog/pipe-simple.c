@@ -0,0 +1,30 @@
+/* Writes to a pipe and reads the data back, then checks end of
+   file and writes with no reader. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static const char data[] = "through the pipe";
+  char buf[64];
+  int fds[2];
+
+  CHECK (pipe (fds) == 0, "pipe");
+  CHECK (fds[0] > 1 && fds[1] > 1 && fds[0] != fds[1], "distinct fds");
+  CHECK (write (fds[1], data, sizeof data) == sizeof data, "write");
+  CHECK (read (fds[0], buf, sizeof buf) == sizeof data, "read");
+  if (memcmp (buf, data, sizeof data))
+    fail ("read returned wrong data");
+  CHECK (read (fds[1], buf, sizeof buf) == -1, "read from write end fails");
+  CHECK (write (fds[0], data, sizeof data) == -1, "write to read end fails");
+  close (fds[1]);
+  CHECK (read (fds[0], buf, sizeof buf) == 0, "end of file");
+  CHECK (pipe (fds + 0) == 0, "second pipe");
+  close (fds[0]);
+  CHECK (write (fds[1], data, sizeof data) == -1, "write with no reader fails");
+  close (fds[1]);
+}
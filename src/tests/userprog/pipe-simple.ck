@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-simple) begin
+(pipe-simple) pipe
+(pipe-simple) distinct fds
+(pipe-simple) write
+(pipe-simple) read
+(pipe-simple) read from write end fails
+(pipe-simple) write to read end fails
+(pipe-simple) end of file
+(pipe-simple) second pipe
+(pipe-simple) write with no reader fails
+(pipe-simple) end
+pipe-simple: exit(0)
+EOF
+pass;
@@ -0,0 +1,70 @@
+/* Checks poll() on pipe ends and the console, lets a timeout run
+   out, and then waits in poll() for a child that writes more
+   through a pipe than it holds at once, reading everything back
+   and seeing the pipe hang up at the end. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/userprog/pipe-child.h"
+
+void
+test_main (void) 
+{
+  struct pollfd pfd[3];
+  char child_cmd[128];
+  char buf[1000];
+  size_t total = 0;
+  int64_t start;
+  pid_t child;
+  int fds[2];
+  int n;
+
+  CHECK (pipe (fds) == 0, "pipe");
+
+  pfd[0].fd = fds[0];
+  pfd[0].events = POLLIN;
+  pfd[1].fd = fds[1];
+  pfd[1].events = POLLIN | POLLOUT;
+  pfd[2].fd = STDOUT_FILENO;
+  pfd[2].events = POLLOUT;
+  CHECK (poll (pfd, 3, 0) == 2, "two of three ready");
+  CHECK (pfd[0].revents == 0, "empty pipe not readable");
+  CHECK (pfd[1].revents == POLLOUT, "pipe writable");
+  CHECK (pfd[2].revents == POLLOUT, "console writable");
+
+  pfd[1].fd = -1;
+  pfd[2].fd = 0x20101234;
+  pfd[2].events = POLLIN;
+  CHECK (poll (pfd, 3, 0) == 1, "one of three ready");
+  CHECK (pfd[1].revents == 0, "negative fd ignored");
+  CHECK (pfd[2].revents == POLLNVAL, "bad fd reported");
+
+  start = get_ticks ();
+  CHECK (poll (pfd, 1, 50) == 0, "poll with timeout");
+  if (get_ticks () == start)
+    fail ("poll returned before timeout");
+  msg ("timeout ran out");
+
+  snprintf (child_cmd, sizeof child_cmd, "child-pipe %d", fds[1]);
+  CHECK ((child = exec (child_cmd)) != -1, "exec \"%s\"", child_cmd);
+  close (fds[1]);
+
+  for (;;) 
+    {
+      if (poll (pfd, 1, -1) != 1)
+        fail ("poll without timeout returned nothing ready");
+      if (!(pfd[0].revents & POLLIN))
+        break;
+      n = read (fds[0], buf, sizeof buf);
+      if (n <= 0)
+        fail ("read %d bytes after POLLIN", n);
+      total += n;
+    }
+  if (total != PIPE_CHILD_SIZE)
+    fail ("read %zu bytes, expected %d", total, PIPE_CHILD_SIZE);
+  msg ("read all data");
+  CHECK (pfd[0].revents == POLLHUP, "hang-up after last write");
+  CHECK (wait (child) == 0, "wait for child");
+}
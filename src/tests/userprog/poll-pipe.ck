@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(poll-pipe) begin
+(poll-pipe) pipe
+(poll-pipe) two of three ready
+(poll-pipe) empty pipe not readable
+(poll-pipe) pipe writable
+(poll-pipe) console writable
+(poll-pipe) one of three ready
+(poll-pipe) negative fd ignored
+(poll-pipe) bad fd reported
+(poll-pipe) poll with timeout
+(poll-pipe) timeout ran out
+(poll-pipe) exec "child-pipe 3"
+child-pipe: exit(0)
+(poll-pipe) read all data
+(poll-pipe) hang-up after last write
+(poll-pipe) wait for child
+(poll-pipe) end
+poll-pipe: exit(0)
+EOF
+pass;
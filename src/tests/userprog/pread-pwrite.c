@@ -0,0 +1,27 @@
+/* Writes and reads a file at explicit offsets and checks that
+   the file position is left alone. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static const char data[] = "positional";
+  char buf[sizeof data];
+  int fd;
+
+  CHECK (create ("pfile", 64), "create \"pfile\"");
+  CHECK ((fd = open ("pfile")) > 1, "open \"pfile\"");
+  CHECK (pwrite (fd, data, sizeof data, 20) == sizeof data,
+         "pwrite at offset 20");
+  CHECK (tell (fd) == 0, "position still 0");
+  CHECK (pread (fd, buf, sizeof buf, 20) == sizeof buf, "pread at offset 20");
+  if (memcmp (buf, data, sizeof data))
+    fail ("pread returned wrong data");
+  CHECK (pread (fd, buf, sizeof buf, 64) == 0, "pread at end of file");
+  CHECK (tell (fd) == 0, "position still 0");
+  CHECK (pread (0, buf, sizeof buf, 0) == -1, "pread from console fails");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) create "pfile"
+(pread-pwrite) open "pfile"
+(pread-pwrite) pwrite at offset 20
+(pread-pwrite) position still 0
+(pread-pwrite) pread at offset 20
+(pread-pwrite) pread at end of file
+(pread-pwrite) position still 0
+(pread-pwrite) pread from console fails
+(pread-pwrite) end
+pread-pwrite: exit(0)
+EOF
+pass;
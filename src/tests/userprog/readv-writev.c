@@ -0,0 +1,26 @@
+/* Gathers three buffers into a file with writev and scatters
+   them back out with readv into differently sized buffers. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char a[] = "scatter", b[] = "-", c[] = "gather";
+  char x[5], y[10];
+  struct iovec out[3] = {{a, 7}, {b, 1}, {c, 6}};
+  struct iovec in[2] = {{x, sizeof x}, {y, sizeof y}};
+  int fd;
+
+  CHECK (create ("vfile", 0), "create \"vfile\"");
+  CHECK ((fd = open ("vfile")) > 1, "open \"vfile\"");
+  CHECK (writev (fd, out, 3) == 14, "writev 3 buffers");
+  seek (fd, 0);
+  CHECK (readv (fd, in, 2) == 14, "readv 2 buffers");
+  if (memcmp (x, "scatt", 5) || memcmp (y, "er-gat", 6))
+    fail ("readv returned wrong data");
+  CHECK (writev (fd, out, -1) == -1, "writev with negative count fails");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(readv-writev) begin
+(readv-writev) create "vfile"
+(readv-writev) open "vfile"
+(readv-writev) writev 3 buffers
+(readv-writev) readv 2 buffers
+(readv-writev) writev with negative count fails
+(readv-writev) end
+readv-writev: exit(0)
+EOF
+pass;
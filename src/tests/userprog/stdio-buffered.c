@@ -0,0 +1,71 @@
+/* Reads sample.txt a line at a time with hgetline(), checks that
+   tell() accounts for buffered input and output, checks that
+   closing a buffered handle frees its buffer, and checks that
+   fully buffered standard output waits for fflush() or exit()
+   before it appears. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char line[128];
+  size_t ofs = 0;
+  int fd, fd2, len, line_cnt = 0, i;
+
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  while ((len = hgetline (fd, line, sizeof line)) > 0) 
+    {
+      if (memcmp (line, sample + ofs, len))
+        fail ("line %d differs from sample.txt", line_cnt + 1);
+      ofs += len;
+      line_cnt++;
+      if (tell (fd) != ofs)
+        fail ("tell() is %u after reading %zu bytes", tell (fd), ofs);
+    }
+  if (ofs != sizeof sample - 1)
+    fail ("read %zu bytes, expected %zu", ofs, sizeof sample - 1);
+  msg ("read %d lines", line_cnt);
+  close (fd);
+
+  /* A handle that reuses a closed buffered handle's number must
+     not inherit its buffer. */
+  CHECK (create ("buffered", 8), "create \"buffered\"");
+  CHECK ((fd = open ("buffered")) > 1, "open \"buffered\"");
+  CHECK (hsetvbuf (fd, _IOFBF) == 0, "fully buffer \"buffered\"");
+  hprintf (fd, "abc");
+  CHECK (tell (fd) == 3, "tell() counts buffered output");
+  close (fd);
+  CHECK (open ("buffered") == fd, "reopen \"buffered\"");
+  hprintf (fd, "xyz");
+  CHECK ((fd2 = open ("buffered")) > 1, "open \"buffered\" again");
+  if (read (fd2, line, 3) != 3 || memcmp (line, "xyz", 3))
+    fail ("write to reopened handle was buffered");
+  msg ("reopened handle is unbuffered");
+  close (fd2);
+  close (fd);
+
+  /* Closing buffered handles must free their buffers. */
+  for (i = 0; i < 8; i++) 
+    {
+      fd = open ("buffered");
+      if (fd < 2)
+        fail ("open \"buffered\" failed");
+      if (hsetvbuf (fd, _IOFBF) != 0)
+        fail ("hsetvbuf failed after %d buffered handles closed", i);
+      close (fd);
+    }
+  msg ("buffered and closed %d handles", i);
+
+  CHECK (hsetvbuf (STDOUT_FILENO, _IOFBF) == 0, "fully buffer stdout");
+  printf ("buffered before fflush\n");
+  msg ("written directly");
+  fflush (STDOUT_FILENO);
+  msg ("flushed");
+  printf ("buffered until exit\n");
+}
@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(stdio-buffered) begin
+(stdio-buffered) open "sample.txt"
+(stdio-buffered) read 4 lines
+(stdio-buffered) create "buffered"
+(stdio-buffered) open "buffered"
+(stdio-buffered) fully buffer "buffered"
+(stdio-buffered) tell() counts buffered output
+(stdio-buffered) reopen "buffered"
+(stdio-buffered) open "buffered" again
+(stdio-buffered) reopened handle is unbuffered
+(stdio-buffered) buffered and closed 8 handles
+(stdio-buffered) fully buffer stdout
+(stdio-buffered) written directly
+buffered before fflush
+(stdio-buffered) flushed
+(stdio-buffered) end
+buffered until exit
+stdio-buffered: exit(0)
+EOF
+pass;
@@ -0,0 +1,22 @@
+/* Switches console input between canonical and raw mode and
+   checks that tty_mode() reports the old mode each time and
+   rejects an invalid one.  Reading an empty buffer from the
+   console must not wait for input. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char c;
+
+  CHECK (tty_mode (TTY_RAW) == TTY_CANONICAL, "canonical by default");
+  CHECK (tty_mode (TTY_RAW) == TTY_RAW, "raw mode set");
+  CHECK (tty_mode (TTY_CANONICAL) == TTY_RAW, "back to canonical");
+  CHECK (tty_mode (42) == -1, "invalid mode rejected");
+  CHECK (tty_mode (TTY_CANONICAL) == TTY_CANONICAL, "still canonical");
+  CHECK (read (STDIN_FILENO, &c, 0) == 0, "empty read from console");
+}
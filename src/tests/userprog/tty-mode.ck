@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(tty-mode) begin
+(tty-mode) canonical by default
+(tty-mode) raw mode set
+(tty-mode) back to canonical
+(tty-mode) invalid mode rejected
+(tty-mode) still canonical
+(tty-mode) empty read from console
+(tty-mode) end
+tty-mode: exit(0)
+EOF
+pass;
@@ -0,0 +1,77 @@
+/* Queues a batch of file operations in a system call ring and
+   runs them with a single uring_enter(). */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct uring ring __attribute__ ((aligned (4096)));
+
+/* Queues an operation. */
+static void
+submit (enum uring_op op, int fd, void *addr, unsigned len, unsigned id) 
+{
+  struct uring_sqe *sqe = &ring.sq[ring.sq_tail % URING_ENTRIES];
+  sqe->op = op;
+  sqe->fd = fd;
+  sqe->addr = addr;
+  sqe->len = len;
+  sqe->user_data = id;
+  ring.sq_tail++;
+}
+
+/* Returns the result of the next completion, which must be for
+   operation ID. */
+static int
+reap (unsigned id) 
+{
+  struct uring_cqe *cqe;
+
+  if (ring.cq_head == ring.cq_tail)
+    fail ("no completion for operation %u", id);
+  cqe = &ring.cq[ring.cq_head++ % URING_ENTRIES];
+  if (cqe->user_data != id)
+    fail ("completion for operation %u, expected %u", cqe->user_data, id);
+  return cqe->res;
+}
+
+void
+test_main (void) 
+{
+  static char name[] = "ring";
+  static char data[] = "batched";
+  char buf[3 * sizeof data];
+  int fd;
+
+  CHECK (uring_enter (1) == -1, "enter before setup fails");
+  CHECK (create (name, sizeof buf), "create \"ring\"");
+  CHECK (uring_setup (&ring) == 0, "setup");
+
+  submit (URING_OPEN, 0, name, 0, 1);
+  CHECK (uring_enter (1) == 1, "enter open");
+  CHECK ((fd = reap (1)) > 1, "open \"ring\"");
+
+  submit (URING_WRITE, fd, data, sizeof data, 2);
+  submit (URING_WRITE, fd, data, sizeof data, 3);
+  submit (URING_WRITE, fd, data, sizeof data, 4);
+  submit (URING_SEEK, fd, NULL, 0, 5);
+  submit (URING_READ, fd, buf, sizeof buf, 6);
+  submit (URING_CLOSE, fd, NULL, 0, 7);
+  submit (URING_NOP, 0, NULL, 0, 8);
+  submit (99, 0, NULL, 0, 9);
+  CHECK (uring_enter (URING_ENTRIES) == 8, "enter batch of 8");
+
+  CHECK (reap (2) == sizeof data, "write 1 completed");
+  CHECK (reap (3) == sizeof data, "write 2 completed");
+  CHECK (reap (4) == sizeof data, "write 3 completed");
+  CHECK (reap (5) == 0, "seek completed");
+  CHECK (reap (6) == sizeof buf, "read completed");
+  if (memcmp (buf + 2 * sizeof data, data, sizeof data))
+    fail ("read returned wrong data");
+  CHECK (reap (7) == 0, "close completed");
+  CHECK (reap (8) == 0, "nop completed");
+  CHECK (reap (9) == -1, "unknown operation fails");
+  CHECK (ring.sq_head == ring.sq_tail, "submission ring empty");
+  CHECK (uring_enter (1) == 0, "enter with nothing queued");
+}
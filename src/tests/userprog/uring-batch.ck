@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(uring-batch) begin
+(uring-batch) enter before setup fails
+(uring-batch) create "ring"
+(uring-batch) setup
+(uring-batch) enter open
+(uring-batch) open "ring"
+(uring-batch) enter batch of 8
+(uring-batch) write 1 completed
+(uring-batch) write 2 completed
+(uring-batch) write 3 completed
+(uring-batch) seek completed
+(uring-batch) read completed
+(uring-batch) close completed
+(uring-batch) nop completed
+(uring-batch) unknown operation fails
+(uring-batch) submission ring empty
+(uring-batch) enter with nothing queued
+(uring-batch) end
+uring-batch: exit(0)
+EOF
+pass;
@@ -0,0 +1,79 @@
+/* Allocates, fills, resizes and frees many blocks of assorted
+   sizes with the user malloc(), checks that calloc() catches
+   overflow, then checks that freeing a large block gives its
+   memory back to the kernel. */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_CNT 200
+#define LARGE_SIZE (256 * 1024)
+
+static uint8_t *blocks[BLOCK_CNT];
+static size_t sizes[BLOCK_CNT];
+
+/* Fails unless the first SIZE bytes of block I hold its pattern. */
+static void
+verify (int i, size_t size) 
+{
+  size_t j;
+
+  for (j = 0; j < size; j++)
+    if (blocks[i][j] != (uint8_t) (i + j))
+      fail ("block %d corrupted at byte %zu", i, j);
+}
+
+void
+test_main (void) 
+{
+  uint8_t *large;
+  uint8_t *brk0;
+  size_t j;
+  int i;
+
+  for (i = 0; i < BLOCK_CNT; i++) 
+    {
+      sizes[i] = (i * 37) % 3000 + 1;
+      blocks[i] = malloc (sizes[i]);
+      if (blocks[i] == NULL)
+        fail ("malloc of %zu bytes failed", sizes[i]);
+      for (j = 0; j < sizes[i]; j++)
+        blocks[i][j] = i + j;
+    }
+  for (i = 0; i < BLOCK_CNT; i++)
+    verify (i, sizes[i]);
+  msg ("allocated and verified %d blocks", BLOCK_CNT);
+
+  for (i = 1; i < BLOCK_CNT; i += 2)
+    free (blocks[i]);
+  for (i = 0; i < BLOCK_CNT; i += 2) 
+    {
+      uint8_t *p = realloc (blocks[i], sizes[i] * 2);
+      if (p == NULL)
+        fail ("realloc of block %d failed", i);
+      blocks[i] = p;
+      verify (i, sizes[i]);
+      for (j = sizes[i]; j < sizes[i] * 2; j++)
+        blocks[i][j] = i + j;
+      sizes[i] *= 2;
+    }
+  for (i = 0; i < BLOCK_CNT; i += 2)
+    verify (i, sizes[i]);
+  msg ("freed odd blocks, resized and verified even blocks");
+  for (i = 0; i < BLOCK_CNT; i += 2)
+    free (blocks[i]);
+
+  CHECK (calloc (0x10001, 0x10001) == NULL, "calloc overflow fails");
+  CHECK ((large = calloc (0, 16)) != NULL, "calloc of 0 elements");
+  free (large);
+
+  brk0 = sbrk (0);
+  CHECK ((large = malloc (LARGE_SIZE)) != NULL, "malloc large block");
+  memset (large, 0x5a, LARGE_SIZE);
+  free (large);
+  CHECK ((uint8_t *) sbrk (0) <= brk0, "large block returned to kernel");
+}
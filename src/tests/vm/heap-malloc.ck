@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(heap-malloc) begin
+(heap-malloc) allocated and verified 200 blocks
+(heap-malloc) freed odd blocks, resized and verified even blocks
+(heap-malloc) calloc overflow fails
+(heap-malloc) calloc of 0 elements
+(heap-malloc) malloc large block
+(heap-malloc) large block returned to kernel
+(heap-malloc) end
+heap-malloc: exit(0)
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Grows the heap with sbrk(), checks that the new pages read as
+   zeros and can be written, then shrinks it again and checks
+   that the break cannot be moved below where it started. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 3
+#define PGSIZE 4096
+
+void
+test_main (void) 
+{
+  uint8_t *start = sbrk (0);
+  size_t i;
+
+  CHECK (sbrk (PAGE_CNT * PGSIZE) == start, "grow heap by %d pages", PAGE_CNT);
+  CHECK (sbrk (0) == start + PAGE_CNT * PGSIZE, "break moved");
+  for (i = 0; i < PAGE_CNT * PGSIZE; i++)
+    if (start[i] != 0)
+      fail ("byte %zu of new heap is %d, not 0", i, start[i]);
+  for (i = 0; i < PAGE_CNT * PGSIZE; i++)
+    start[i] = i % 251;
+  for (i = 0; i < PAGE_CNT * PGSIZE; i++)
+    if (start[i] != i % 251)
+      fail ("byte %zu of heap changed", i);
+  msg ("heap contents verified");
+
+  CHECK (sbrk (-PAGE_CNT * PGSIZE) == start + PAGE_CNT * PGSIZE,
+         "shrink heap");
+  CHECK (sbrk (0) == start, "break back at start");
+  CHECK (sbrk (-PGSIZE) == (void *) -1, "shrink below start fails");
+  CHECK (brk (start + PGSIZE) == 0, "brk grows heap");
+  CHECK (start[0] == 0, "page from brk reads as zero");
+  CHECK (brk (start) == 0, "brk shrinks heap");
+  CHECK (sbrk (0x40000000) == (void *) -1, "huge sbrk fails");
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(heap-sbrk) begin
+(heap-sbrk) grow heap by 3 pages
+(heap-sbrk) break moved
+(heap-sbrk) heap contents verified
+(heap-sbrk) shrink heap
+(heap-sbrk) break back at start
+(heap-sbrk) shrink below start fails
+(heap-sbrk) brk grows heap
+(heap-sbrk) page from brk reads as zero
+(heap-sbrk) brk shrinks heap
+(heap-sbrk) huge sbrk fails
+(heap-sbrk) end
+heap-sbrk: exit(0)
+EOF
+pass;
@@ -0,0 +1,66 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* CPU feature detection and model-specific registers. */
+
+/* CPUID.1:EDX feature flags.  See [IA32-v2a] "CPUID--CPU
+   Identification". */
+#define CPUID_PSE 0x00000008    /* 4 MB pages. */
+#define CPUID_SEP 0x00000800    /* SYSENTER and SYSEXIT. */
+#define CPUID_PGE 0x00002000    /* Global pages. */
+
+/* CR4 bits.  See [IA32-v3a] 2.5 "Control Registers". */
+#define CR4_PSE 0x00000010      /* Page Size Extensions. */
+#define CR4_PGE 0x00000080      /* Page Global Enable. */
+
+/* Model-specific registers that configure SYSENTER.  See
+   [IA32-v3a] 4.8.7 "Fast System Calls". */
+#define MSR_SYSENTER_CS  0x174  /* Kernel code selector. */
+#define MSR_SYSENTER_ESP 0x175  /* Kernel stack pointer. */
+#define MSR_SYSENTER_EIP 0x176  /* Kernel entry point. */
+
+/* Runs CPUID leaf 1 and returns EAX, the processor signature,
+   in *SIGNATURE if it is nonnull, and EDX, the basic feature
+   flags, as the result.  Every CPU that can run Pintos supports
+   CPUID leaf 1. */
+static inline uint32_t
+cpu_features (uint32_t *signature)
+{
+  uint32_t eax = 1, ebx, ecx, edx;
+  asm ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  if (signature != NULL)
+    *signature = eax;
+  return edx;
+}
+
+/* Returns true if SYSENTER and SYSEXIT work.  The earliest
+   Pentium Pro steppings report them in CPUID but do not
+   implement them. */
+static inline bool
+cpu_has_sysenter (void)
+{
+  uint32_t signature;
+  uint32_t features = cpu_features (&signature);
+  unsigned family = (signature >> 8) & 0xf;
+  unsigned model = (signature >> 4) & 0xf;
+  unsigned stepping = signature & 0xf;
+
+  if ((features & CPUID_SEP) == 0)
+    return false;
+  return !(family == 6 && model < 3 && stepping < 3);
+}
+
+/* Writes VALUE to model-specific register MSR.  See [IA32-v2b]
+   "WRMSR--Write to Model Specific Register". */
+static inline void
+wrmsr (uint32_t msr, uint64_t value)
+{
+  asm volatile ("wrmsr" : : "c" (msr), "a" ((uint32_t) value),
+                "d" ((uint32_t) (value >> 32)));
+}
+
+#endif /* threads/cpu.h */
@@ -13,8 +13,10 @@
 #include "devices/serial.h"
 #include "devices/shutdown.h"
 #include "devices/timer.h"
+#include "devices/tty.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
@@ -23,11 +25,14 @@
 #include "threads/pte.h"
 #include "threads/thread.h"
 #include "vm/frame.h"
+#include "vm/ksm.h"
 
 #ifdef USERPROG
+#include "userprog/aio.h"
 #include "userprog/process.h"
 #include "userprog/exception.h"
 #include "userprog/gdt.h"
+#include "userprog/shared-page.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
 #else
@@ -100,6 +105,9 @@ main (void)
   palloc_init (user_page_limit);
   malloc_init ();
   paging_init ();
+#ifdef USERPROG
+  shared_page_init ();
+#endif
   
   /* Segmentation. */
 #ifdef USERPROG
@@ -112,6 +120,7 @@ main (void)
   timer_init ();
   kbd_init ();
   input_init ();
+  tty_init ();
 #ifdef USERPROG
   exception_init ();
   syscall_init ();
@@ -132,6 +141,8 @@ main (void)
   
   frame_table_init();
   swap_init();
+  ksm_init();
+  aio_init();
   printf ("Boot complete.\n");
   
   /* Run actions specified on kernel command line. */
@@ -158,13 +169,21 @@ bss_init (void)
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   All kernel mappings are global, so process switches leave
+   them in the TLB.  If the CPU has 4 MB pages, each 4 MB of RAM
+   that holds no kernel text is mapped by a single PDE; the rest
+   uses page tables, so that kernel text stays read-only. */
 static void
 paging_init (void)
 {
   uint32_t *pd, *pt;
   size_t page;
   extern char _start, _end_kernel_text;
+  uint32_t features = cpu_features (NULL);
+  bool large = (features & CPUID_PSE) != 0;
+  uint32_t cr4;
 
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
@@ -176,15 +195,33 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      if (large && pte_idx == 0 && page + PTSPAN / PGSIZE <= init_ram_pages
+          && (vaddr + PTSPAN <= &_start || vaddr >= &_end_kernel_text))
+        {
+          pd[pde_idx] = pde_create_large (vaddr, true);
+          page += PTSPAN / PGSIZE - 1;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
           pd[pde_idx] = pde_create (pt);
         }
 
-      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text);
+      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text) | PTE_G;
     }
 
+  /* Turn on 4 MB pages and global pages, if available, before the
+     new page directory is used.  See [IA32-v3a] 2.5 "Control
+     Registers". */
+  asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+  if (large)
+    cr4 |= CR4_PSE;
+  if (features & CPUID_PGE)
+    cr4 |= CR4_PGE;
+  asm volatile ("movl %0, %%cr4" : : "r" (cr4));
+
   /* Store the physical address of the page directory into CR3
      aka PDBR (page directory base register).  This activates our
      new page tables immediately.  See [IA32-v2a] "MOV--Move
@@ -261,9 +298,21 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-bps")) 
+        {
+          serial_bps = atoi (value);
+          if (serial_bps < 300 || serial_bps > 115200)
+            PANIC ("serial speed %s out of range 300...115200", value);
+        }
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-wss"))
+        frame_ws_window = atoi (value);
+      else if (!strcmp (name, "-ksm"))
+        ksm_enabled = true;
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -384,8 +433,13 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -bps=BPS           Run serial port at BPS bits per second.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+          "  -wss=TICKS         Set page replacement working-set window.\n"
+          "  -ksm               Merge identical anonymous pages.\n"
 #endif
           );
   shutdown_power_off ();
@@ -136,6 +136,7 @@ thread_tick (void)
 #endif
   else
     kernel_ticks++;
+  t->vtime++;
 
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
@@ -211,12 +212,13 @@ thread_create (const char *name, int priority,
   sema_init(&(t->sema_exit),0);
   list_push_back(&(t->parent->child_list),&(t->child_elem));
 
+  //the fd table is allocated by the first open
+  t->FD_table=NULL;
+  t->fd_used=NULL;
+  t->fd_cap=0;
   t->fd_max=2;
-  t->FD_table=palloc_get_page(PAL_ZERO);
-  if(t->FD_table==NULL)
-  {
-    return TID_ERROR;
-  }
+  t->fd_hint=2;
+  t->uring=NULL;
   /* Add to run queue. */
   thread_unblock (t);
 
@@ -506,9 +508,12 @@ init_thread (struct thread *t, const char *name, int priority)
   
   list_init(&(t->mmap_list));
   t->mapid=0;
+  t->heap_start=t->heap_end=NULL;
 
   intr_set_level (old_level);
   list_init(&(t->child_list));
+  list_init(&(t->aio_list));
+  t->aio_next_id=0;
 }
 
 /* Allocates a SIZE-byte frame at the top of thread T's stack and
@@ -116,9 +116,15 @@ struct thread
     struct semaphore sema_exit;
     struct semaphore sema_load;
     struct semaphore sema_wait;
-    struct file ** FD_table;
-    int fd_max;
+    struct file ** FD_table;    /* Open files by fd, grown on demand. */
+    uint32_t * fd_used;         /* Bitmap of fds in use. */
+    int fd_cap;                 /* Entries in FD_table. */
+    int fd_max;                 /* One more than the highest open fd. */
+    int fd_hint;                /* No fd below this one is free. */
     struct file * current_file;
+    struct uring * uring;       /* Registered system call ring, or null. */
+    struct list aio_list;       /* Asynchronous I/O not reaped yet. */
+    int aio_next_id;            /* Identifier for the next one. */
 
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
@@ -129,6 +135,9 @@ struct thread
 
    struct list mmap_list;
    int mapid;
+   void * heap_start;                  /* Start of the heap, just above the data. */
+   void * heap_end;                    /* Program break: end of the heap. */
+   int64_t vtime;                      /* Timer ticks spent running. */
   };
 
 /* If false (default), use round-robin scheduler.
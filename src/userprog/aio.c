@@ -0,0 +1,283 @@
+#include "userprog/aio.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+#include "vm/frame.h"
+
+/* Asynchronous file I/O.
+
+   aio_submit() pins every page of the user buffer in the frame
+   table and queues the request for the "aiod" thread, which does
+   the transfer through the frames' kernel addresses, so the
+   process keeps running in the meantime.  The request owns a
+   private reopened file, so closing the descriptor does not
+   affect it, and it always transfers at an explicit offset.
+
+   Requests stay on their owner's aio_list until aio_wait() reaps
+   them.  Before anything can unmap or free the pinned pages, at
+   munmap() or process exit, aio_drain() waits for the rest. */
+
+/* Most pages one request may pin. */
+#define AIO_MAX_PAGES 32
+
+/* An asynchronous read or write. */
+struct aio_request
+  {
+    int id;                     /* Identifier returned to the user. */
+    bool write;                 /* Write to the file, or read from it? */
+    struct file *file;          /* Private handle on the file. */
+    off_t offset;               /* File offset. */
+    size_t page_ofs;            /* Buffer's offset in its first page. */
+    size_t size;                /* Bytes to transfer. */
+    size_t page_cnt;            /* Number of pinned frames. */
+    struct frame *frames[AIO_MAX_PAGES]; /* The buffer's frames. */
+    uint32_t *pagedir;          /* Owner's page directory. */
+    int result;                 /* Bytes transferred, once done. */
+    bool done;                  /* Completed?  Protected by aio_lock. */
+    struct list_elem queue_elem; /* Element in aio_queue. */
+    struct list_elem thread_elem; /* Element in owner's aio_list. */
+  };
+
+static struct list aio_queue;   /* Requests not started yet. */
+static struct lock aio_lock;    /* Protects aio_queue and `done'. */
+static struct condition aio_queued; /* Signaled when queue grows. */
+static struct condition aio_completed; /* Broadcast on completion. */
+
+static void aio_daemon (void *aux);
+static void aio_transfer (struct aio_request *);
+static struct aio_request *find_request (int id);
+static void free_request (struct aio_request *);
+
+/* Starts the I/O thread. */
+void
+aio_init (void) 
+{
+  list_init (&aio_queue);
+  lock_init (&aio_lock);
+  cond_init (&aio_queued);
+  cond_init (&aio_completed);
+  thread_create ("aiod", PRI_DEFAULT, aio_daemon, NULL);
+}
+
+/* Queues a transfer of SIZE bytes between BUFFER and the file
+   open as FD, at byte OFFSET in the file: from the file into
+   BUFFER if WRITE is false, the other way if it is true.
+   Returns a nonnegative request identifier for aio_wait(), or -1
+   if FD is not an open file or the buffer is too large. */
+int
+aio_submit (int fd, void *buffer, unsigned size, unsigned offset, bool write)
+{
+  struct thread *t = thread_current ();
+  struct aio_request *r;
+  struct file *file;
+  size_t i;
+
+  if (fd < 2 || (off_t) offset < 0 || (off_t) size < 0)
+    return -1;
+  check_valid_buffer (buffer, size, !write);
+
+  r = malloc (sizeof *r);
+  if (r == NULL)
+    return -1;
+  r->write = write;
+  r->offset = offset;
+  r->page_ofs = pg_ofs (buffer);
+  r->size = size;
+  r->page_cnt = DIV_ROUND_UP (r->page_ofs + size, PGSIZE);
+  r->pagedir = t->pagedir;
+  r->done = false;
+  if (r->page_cnt > AIO_MAX_PAGES)
+    {
+      free (r);
+      return -1;
+    }
+
+  lock_acquire (&filesys_lock);
+  file = process_file_get (fd);
+  r->file = file != NULL ? file_reopen (file) : NULL;
+  lock_release (&filesys_lock);
+  if (r->file == NULL)
+    {
+      free (r);
+      return -1;
+    }
+
+  for (i = 0; i < r->page_cnt; i++)
+    {
+      r->frames[i] = frame_pin_user (pg_round_down (buffer) + i * PGSIZE);
+      if (r->frames[i] == NULL)
+        {
+          r->page_cnt = i;
+          free_request (r);
+          return -1;
+        }
+    }
+
+  r->id = t->aio_next_id++;
+  list_push_back (&t->aio_list, &r->thread_elem);
+  lock_acquire (&aio_lock);
+  list_push_back (&aio_queue, &r->queue_elem);
+  cond_signal (&aio_queued, &aio_lock);
+  lock_release (&aio_lock);
+  return r->id;
+}
+
+/* Waits for request ID to complete, then returns the number of
+   bytes it transferred and forgets it.  Returns -1 if ID is not
+   an outstanding request of this process. */
+int
+aio_wait (int id) 
+{
+  struct aio_request *r = find_request (id);
+  int result;
+
+  if (r == NULL)
+    return -1;
+  lock_acquire (&aio_lock);
+  while (!r->done)
+    cond_wait (&aio_completed, &aio_lock);
+  lock_release (&aio_lock);
+
+  result = r->result;
+  list_remove (&r->thread_elem);
+  free_request (r);
+  return result;
+}
+
+/* Returns the identifier of a completed request that has not
+   been reaped by aio_wait() yet, or -1 if there is none. */
+int
+aio_poll (void) 
+{
+  struct list *aio_list = &thread_current ()->aio_list;
+  struct list_elem *e;
+  int id = -1;
+
+  lock_acquire (&aio_lock);
+  for (e = list_begin (aio_list); e != list_end (aio_list); e = list_next (e))
+    {
+      struct aio_request *r = list_entry (e, struct aio_request, thread_elem);
+      if (r->done)
+        {
+          id = r->id;
+          break;
+        }
+    }
+  lock_release (&aio_lock);
+  return id;
+}
+
+/* Waits for and reaps all of this process's requests. */
+void
+aio_drain (void) 
+{
+  struct list *aio_list = &thread_current ()->aio_list;
+
+  while (!list_empty (aio_list))
+    aio_wait (list_entry (list_front (aio_list),
+                          struct aio_request, thread_elem)->id);
+}
+
+/* Runs queued requests one at a time, forever. */
+static void
+aio_daemon (void *aux UNUSED) 
+{
+  for (;;) 
+    {
+      struct aio_request *r;
+      size_t i;
+
+      lock_acquire (&aio_lock);
+      while (list_empty (&aio_queue))
+        cond_wait (&aio_queued, &aio_lock);
+      r = list_entry (list_pop_front (&aio_queue),
+                      struct aio_request, queue_elem);
+      lock_release (&aio_lock);
+
+      aio_transfer (r);
+      for (i = 0; i < r->page_cnt; i++)
+        frame_unpin_user (r->frames[i]);
+
+      lock_acquire (&aio_lock);
+      r->done = true;
+      cond_broadcast (&aio_completed, &aio_lock);
+      lock_release (&aio_lock);
+    }
+}
+
+/* Does R's transfer a page at a time, stopping at the first
+   short one. */
+static void
+aio_transfer (struct aio_request *r) 
+{
+  size_t ofs = r->page_ofs;
+  size_t i;
+
+  r->result = 0;
+  lock_acquire (&filesys_lock);
+  for (i = 0; i < r->page_cnt && (size_t) r->result < r->size; i++)
+    {
+      struct frame *f = r->frames[i];
+      size_t chunk = PGSIZE - ofs;
+      off_t n;
+
+      if (chunk > r->size - r->result)
+        chunk = r->size - r->result;
+      if (r->write)
+        n = file_write_at (r->file, f->faddr + ofs, chunk,
+                           r->offset + r->result);
+      else
+        {
+          /* The page changed behind the MMU's back. */
+          n = file_read_at (r->file, f->faddr + ofs, chunk,
+                            r->offset + r->result);
+          pagedir_set_dirty (r->pagedir, f->vme->vaddr, true);
+        }
+      r->result += n;
+      if ((size_t) n < chunk)
+        break;
+      ofs = 0;
+    }
+  lock_release (&filesys_lock);
+}
+
+/* Returns the current process's outstanding request ID, or a
+   null pointer if there is none. */
+static struct aio_request *
+find_request (int id) 
+{
+  struct list *aio_list = &thread_current ()->aio_list;
+  struct list_elem *e;
+
+  for (e = list_begin (aio_list); e != list_end (aio_list); e = list_next (e))
+    {
+      struct aio_request *r = list_entry (e, struct aio_request, thread_elem);
+      if (r->id == id)
+        return r;
+    }
+  return NULL;
+}
+
+/* Frees request R, first unpinning its frames unless aiod has
+   done so already. */
+static void
+free_request (struct aio_request *r) 
+{
+  size_t i;
+
+  if (!r->done)
+    for (i = 0; i < r->page_cnt; i++)
+      frame_unpin_user (r->frames[i]);
+  lock_acquire (&filesys_lock);
+  file_close (r->file);
+  lock_release (&filesys_lock);
+  free (r);
+}
@@ -0,0 +1,13 @@
+#ifndef USERPROG_AIO_H
+#define USERPROG_AIO_H
+
+#include <stdbool.h>
+
+void aio_init (void);
+int aio_submit (int fd, void *buffer, unsigned size, unsigned offset,
+                bool write);
+int aio_wait (int id);
+int aio_poll (void);
+void aio_drain (void);
+
+#endif /* userprog/aio.h */
@@ -5,6 +5,7 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "vm/page.h"
+#include "vm/ksm.h"
 #include "userprog/process.h"
 #include "userprog/syscall.h"
 
@@ -156,8 +157,16 @@ page_fault (struct intr_frame *f)
     exit(-1);
 
 
-   if(not_present==false) exit(-1);
+   if(not_present==false) {
+      //write to a merged page: give the writer its own copy
+      struct vm_entry * shared = vm_find_vme(fault_addr);
+      if(write && shared && shared->ksm && shared->writable && ksm_unshare(shared))
+         return;
+      exit(-1);
+   }
    struct vm_entry * vme = vm_find_vme(fault_addr);
+   if(vme==NULL)
+      vme = heap_vme(fault_addr);
    if(vme){
       if(write && !(vme->writable)) exit(-1);
       bool success = handle_mm_fault(vme);
@@ -3,11 +3,26 @@
 #include <stddef.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 
 static uint32_t *active_pd (void);
-static void invalidate_pagedir (uint32_t *);
+static void invalidate_page (uint32_t *, const void *);
+static void flush_tlb (void);
+
+/* Accessed bits cleared by pagedir_clear_accessed_lazy() whose
+   TLB entries have not been invalidated yet.  If more than
+   LAZY_MAX pile up, pagedir_flush_lazy() flushes the whole TLB
+   instead. */
+#define LAZY_MAX 32
+static struct
+  {
+    uint32_t *pd;
+    const void *vpage;
+  }
+lazy[LAZY_MAX];
+static size_t lazy_cnt;
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -22,8 +37,9 @@ pagedir_create (void)
   return pd;
 }
 
-/* Destroys page directory PD, freeing all the pages it
-   references. */
+/* Destroys page directory PD and its page tables.  The user
+   pages it maps belong to the frame table or to the same-page
+   merging code, and process teardown frees them there. */
 void
 pagedir_destroy (uint32_t *pd) 
 {
@@ -37,11 +53,6 @@ pagedir_destroy (uint32_t *pd)
     if (*pde & PTE_P) 
       {
         uint32_t *pt = pde_get_pt (*pde);
-        uint32_t *pte;
-        
-        for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
-          if (*pte & PTE_P) 
-            palloc_free_page (pte_get_page (*pte));
         palloc_free_page (pt);
       }
   palloc_free_page (pd);
@@ -152,7 +163,7 @@ pagedir_clear_page (uint32_t *pd, void *upage)
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
       *pte &= ~PTE_P;
-      invalidate_pagedir (pd);
+      invalidate_page (pd, upage);
     }
 }
 
@@ -180,7 +191,7 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
       else 
         {
           *pte &= ~(uint32_t) PTE_D;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
@@ -209,18 +220,70 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
       else 
         {
           *pte &= ~(uint32_t) PTE_A; 
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
 
+/* Clears the accessed bit in the PTE for virtual page VPAGE in
+   PD, like pagedir_set_accessed (PD, VPAGE, false), but leaves
+   the TLB entry to a later pagedir_flush_lazy().  Until then the
+   CPU may use the page without setting the bit again, which only
+   makes it look idle, so this suits the clock sweep, which clears
+   many bits in a row. */
+void
+pagedir_clear_accessed_lazy (uint32_t *pd, const void *vpage) 
+{
+  uint32_t *pte = lookup_page (pd, vpage, false);
+  enum intr_level old_level;
+
+  if (pte == NULL || (*pte & PTE_A) == 0)
+    return;
+  *pte &= ~(uint32_t) PTE_A;
+  if (pd != active_pd ())
+    return;
+
+  old_level = intr_disable ();
+  if (lazy_cnt < LAZY_MAX)
+    {
+      lazy[lazy_cnt].pd = pd;
+      lazy[lazy_cnt].vpage = vpage;
+    }
+  lazy_cnt++;
+  intr_set_level (old_level);
+}
+
+/* Invalidates the TLB entries left behind by
+   pagedir_clear_accessed_lazy(), one page at a time if there are
+   few of them, otherwise by flushing the whole TLB. */
+void
+pagedir_flush_lazy (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  uint32_t *pd = active_pd ();
+  size_t i;
+
+  if (lazy_cnt > LAZY_MAX)
+    flush_tlb ();
+  else
+    for (i = 0; i < lazy_cnt; i++)
+      if (lazy[i].pd == pd)
+        asm volatile ("invlpg (%0)" : : "r" (lazy[i].vpage) : "memory");
+  lazy_cnt = 0;
+  intr_set_level (old_level);
+}
+
 /* Loads page directory PD into the CPU's page directory base
-   register. */
+   register.  Does nothing if PD is already active, which spares
+   the TLB when switching between kernel threads or back to the
+   same process. */
 void
 pagedir_activate (uint32_t *pd) 
 {
   if (pd == NULL)
     pd = init_page_dir;
+  if (pd == active_pd ())
+    return;
 
   /* Store the physical address of the page directory into CR3
      aka PDBR (page directory base register).  This activates our
@@ -245,19 +308,29 @@ active_pd (void)
 
 /* Seom page table changes can cause the CPU's translation
    lookaside buffer (TLB) to become out-of-sync with the page
-   table.  When this happens, we have to "invalidate" the TLB by
-   re-activating it.
+   table.  When this happens, we have to "invalidate" the TLB
+   entry for the page.
 
-   This function invalidates the TLB if PD is the active page
-   directory.  (If PD is not active then its entries are not in
-   the TLB, so there is no need to invalidate anything.) */
+   This function invalidates the TLB entry for VPAGE if PD is the
+   active page directory.  (If PD is not active then its entries
+   are not in the TLB, so there is no need to invalidate
+   anything.) */
 static void
-invalidate_pagedir (uint32_t *pd) 
+invalidate_page (uint32_t *pd, const void *vpage) 
 {
   if (active_pd () == pd) 
     {
-      /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
-         "Translation Lookaside Buffers (TLBs)". */
-      pagedir_activate (pd);
+      /* INVLPG drops just the one entry.  See [IA32-v2a]
+         "INVLPG--Invalidate TLB Entry". */
+      asm volatile ("invlpg (%0)" : : "r" (vpage) : "memory");
     } 
 }
+
+/* Flushes every non-global TLB entry by reloading CR3.  See
+   [IA32-v3a] 3.12 "Translation Lookaside Buffers (TLBs)". */
+static void
+flush_tlb (void) 
+{
+  uintptr_t cr3;
+  asm volatile ("movl %%cr3, %0; movl %0, %%cr3" : "=r" (cr3) : : "memory");
+}
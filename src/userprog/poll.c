@@ -0,0 +1,146 @@
+#include "userprog/poll.h"
+#include <list.h>
+#include <round.h>
+#include "devices/timer.h"
+#include "devices/tty.h"
+#include "filesys/file.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Readiness multiplexing for poll().
+
+   A thread in poll_fds() that finds nothing ready sleeps on a
+   single wait queue shared by all pollers.  Anything that might
+   make a descriptor ready calls poll_wake(), which wakes every
+   poller to check its descriptors again: console input arriving
+   from the keyboard or serial port, and data or space appearing
+   in a pipe or an end of it closing.  The timer interrupt wakes
+   pollers whose timeout has run out through poll_tick().
+
+   The queue is touched from interrupt handlers, so it is
+   protected by disabling interrupts.  A poller joins it before
+   checking its descriptors, so a wake-up that comes after the
+   check is never lost. */
+
+/* A thread waiting in poll_fds(). */
+struct poll_waiter
+  {
+    struct list_elem elem;      /* Element in `waiters'. */
+    struct semaphore sema;      /* Upped to wake the thread. */
+    int64_t deadline;           /* Tick to give up at, or INT64_MAX. */
+  };
+
+/* Waiting threads.  Interrupts must be off to access. */
+static struct list waiters = LIST_INITIALIZER (waiters);
+
+/* Earliest deadline in `waiters' not yet reached, or INT64_MAX. */
+static int64_t next_deadline = INT64_MAX;
+
+static int check_fd (int fd, int events);
+
+/* Checks each descriptor in FDS, CNT in all, for the events in
+   its `events' member and records what it finds in `revents'.
+   Waits until at least one descriptor has something to report,
+   or until TIMEOUT milliseconds have passed; a negative TIMEOUT
+   waits indefinitely and zero does not wait at all.  Returns the
+   number of descriptors with nonzero `revents'. */
+int
+poll_fds (struct pollfd *fds, size_t cnt, int timeout) 
+{
+  struct poll_waiter w;
+  enum intr_level old_level;
+  int ready_cnt;
+
+  sema_init (&w.sema, 0);
+  w.deadline = INT64_MAX;
+  if (timeout >= 0)
+    w.deadline = (timer_ticks ()
+                  + DIV_ROUND_UP ((int64_t) timeout * TIMER_FREQ, 1000));
+
+  old_level = intr_disable ();
+  list_push_back (&waiters, &w.elem);
+  if (w.deadline < next_deadline)
+    next_deadline = w.deadline;
+  intr_set_level (old_level);
+
+  for (;;) 
+    {
+      size_t i;
+
+      ready_cnt = 0;
+      for (i = 0; i < cnt; i++) 
+        {
+          fds[i].revents = check_fd (fds[i].fd, fds[i].events);
+          if (fds[i].revents != 0)
+            ready_cnt++;
+        }
+      if (ready_cnt > 0 || timer_ticks () >= w.deadline)
+        break;
+      sema_down (&w.sema);
+    }
+
+  old_level = intr_disable ();
+  list_remove (&w.elem);
+  intr_set_level (old_level);
+
+  return ready_cnt;
+}
+
+/* Wakes every thread waiting in poll_fds() to check its
+   descriptors again.  May be called from an interrupt
+   handler. */
+void
+poll_wake (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  struct list_elem *e;
+
+  for (e = list_begin (&waiters); e != list_end (&waiters); e = list_next (e))
+    sema_up (&list_entry (e, struct poll_waiter, elem)->sema);
+  intr_set_level (old_level);
+}
+
+/* Wakes threads in poll_fds() whose timeout has run out.  Called
+   by the timer interrupt handler at each tick. */
+void
+poll_tick (int64_t ticks) 
+{
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  if (ticks < next_deadline)
+    return;
+
+  next_deadline = INT64_MAX;
+  for (e = list_begin (&waiters); e != list_end (&waiters); e = list_next (e)) 
+    {
+      struct poll_waiter *w = list_entry (e, struct poll_waiter, elem);
+      if (w->deadline <= ticks)
+        sema_up (&w->sema);
+      else if (w->deadline < next_deadline)
+        next_deadline = w->deadline;
+    }
+}
+
+/* Returns the events in EVENTS that descriptor FD of the running
+   process is ready for, plus any of POLLERR, POLLHUP, and
+   POLLNVAL that apply. */
+static int
+check_fd (int fd, int events) 
+{
+  struct thread *t = thread_current ();
+  struct file *file;
+
+  if (fd < 0)
+    return 0;
+  else if (fd == 0)
+    return tty_ready () ? events & POLLIN : 0;
+  else if (fd == 1)
+    return events & POLLOUT;
+
+  file = fd < t->fd_max ? t->FD_table[fd] : NULL;
+  if (file == NULL)
+    return POLLNVAL;
+  return file_poll (file, events);
+}
@@ -0,0 +1,12 @@
+#ifndef USERPROG_POLL_H
+#define USERPROG_POLL_H
+
+#include <poll.h>
+#include <stddef.h>
+#include <stdint.h>
+
+int poll_fds (struct pollfd *, size_t cnt, int timeout);
+void poll_wake (void);
+void poll_tick (int64_t ticks);
+
+#endif /* userprog/poll.h */
@@ -5,8 +5,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/aio.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
+#include "userprog/shared-page.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
@@ -14,6 +16,7 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
@@ -23,6 +26,7 @@
 
 static thread_func start_process NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static void inherit_pipes(struct thread * parent);
 
 extern struct lock filesys_lock;
 
@@ -118,6 +122,7 @@ start_process (void *file_name_)
       exit (-1);
     }
 
+  inherit_pipes(cur->parent);
   cur->is_load=true;
   sema_up (&(cur->sema_load));
   argument_stack(argv,argc,&if_.esp);
@@ -169,6 +174,7 @@ void
 process_exit (void)
 {
   struct thread *cur = thread_current ();
+  struct list frames;
   uint32_t *pd;
   int i;
   
@@ -179,9 +185,20 @@ process_exit (void)
     process_file_close(i);
   }
   file_close(cur->current_file);
+
+  /* Wait for asynchronous I/O, which keeps frames pinned. */
+  aio_drain();
+
+  /* Take all our frames away from the page replacement code in
+     one pass, then write back mmaps and release swap slots in
+     bulk.  The frames stay mapped until the page directory goes
+     away, so nothing is unmapped page by page. */
+  list_init(&frames);
+  frame_collect(cur, &frames);
   munmap(CLOSE_ALL);
 
-  palloc_free_page(cur->FD_table);
+  free(cur->FD_table);
+  free(cur->fd_used);
   vm_destroy(&(cur->vm));
 
   pd = cur->pagedir;
@@ -197,7 +214,9 @@ process_exit (void)
       cur->pagedir = NULL;
       pagedir_activate (NULL);
       pagedir_destroy (pd);
+      shared_page_add_process (-1);
     }
+  frame_free_list(&frames);
     thread_current()->is_exit = true;
     //sema_up(&cur->sema_wait);
     //sema_down(&cur->sema_exit);
@@ -306,6 +325,9 @@ load (const char *file_name, void (**eip) (void), void **esp)
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL) 
     goto done;
+  shared_page_add_process (1);
+  if (!shared_page_map (t->pagedir))
+    goto done;
   process_activate ();
 
   lock_acquire(&filesys_lock);
@@ -387,6 +409,12 @@ load (const char *file_name, void (**eip) (void), void **esp)
               if (!load_segment (file, file_page, (void *) mem_page,
                                  read_bytes, zero_bytes, writable))
                 goto done;
+
+              /* The heap starts above the highest segment. */
+              if (mem_page + read_bytes + zero_bytes
+                  > (uint32_t) t->heap_start)
+                t->heap_start = t->heap_end
+                  = (void *) (mem_page + read_bytes + zero_bytes);
             }
           else
             goto done;
@@ -503,6 +531,8 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
     vme-> is_loaded=false;//lazy loading
     vme-> read_bytes=page_read_bytes;
     vme-> zero_bytes=page_zero_bytes;
+    vme-> swap_slot=SWAP_NONE;
+    vme-> ksm=NULL;
 
     vm_insert_vme(&(thread_current()->vm),vme);
     
@@ -542,8 +572,11 @@ setup_stack (void **esp)
   vme-> vaddr= pg_round_down(vaddr);
   vme-> writable=true;
   vme-> is_loaded=true;//lazy loading
+  vme-> swap_slot=SWAP_NONE;
+  vme-> ksm=NULL;
   kpage->vme = vme;
   vm_insert_vme(&thread_current()->vm, vme);
+  frame_unpin(kpage);
 
   return success;
 }
@@ -624,12 +657,74 @@ void remove_child (struct thread * child)
   list_remove(&(child->child_elem));
 }
 
+/* File descriptors.  Each open file gets the lowest free fd,
+   found through the fd_used bitmap starting at fd_hint, and keeps
+   that number until it is closed.  fds 0 and 1 are the console
+   and are always marked used.  The table doubles when full. */
+#define FD_MIN_CAP 32
+
+//double the fd table. false if out of memory
+static bool fd_table_grow(struct thread * t)
+{
+  int cap = t->fd_cap == 0 ? FD_MIN_CAP : t->fd_cap * 2;
+  struct file ** table = realloc(t->FD_table, cap * sizeof *table);
+  if(table == NULL)
+    return false;
+  t->FD_table = table;
+
+  uint32_t * used = realloc(t->fd_used, cap / 32 * sizeof *used);
+  if(used == NULL)
+    return false;
+  t->fd_used = used;
+
+  memset(table + t->fd_cap, 0, (cap - t->fd_cap) * sizeof *table);
+  memset(used + t->fd_cap / 32, 0, (cap - t->fd_cap) / 32 * sizeof *used);
+  if(t->fd_cap == 0)
+    used[0] = 3;
+  t->fd_cap = cap;
+  return true;
+}
+
+//install F at the lowest free fd and return it, or -1 if out of memory
 int process_file_add (struct file * f) {
   struct thread * t = thread_current();
+  int w, fd;
+
+  for(w = t->fd_hint / 32; w < t->fd_cap / 32; w++)
+    if(t->fd_used[w] != 0xffffffff)
+      break;
+  if(w == t->fd_cap / 32 && !fd_table_grow(t))
+    return -1;
+
+  fd = w * 32 + __builtin_ctz(~t->fd_used[w]);
+  t->fd_used[w] |= 1u << (fd % 32);
+  t->FD_table[fd] = f;
+  t->fd_hint = fd + 1;
+  if(fd >= t->fd_max)
+    t->fd_max = fd + 1;
+  return fd;
+}
 
-  t->FD_table[t->fd_max] = f;
-  t->fd_max++;
-  return t->fd_max;
+/* Gives the current process its own ends of the pipes PARENT has
+   open, at the same fds.  Other files are not inherited.  PARENT
+   is blocked in exec() meanwhile, so its table holds still. */
+static void inherit_pipes(struct thread * parent) {
+  struct thread * t = thread_current();
+  int fd;
+
+  for(fd = 2; fd < parent->fd_max; fd++) {
+    struct file * f = parent->FD_table[fd];
+    if(f == NULL || !file_is_pipe(f))
+      continue;
+    while(fd >= t->fd_cap)
+      if(!fd_table_grow(t))
+        return;
+    if((f = file_dup(f)) == NULL)
+      return;
+    t->FD_table[fd] = f;
+    t->fd_used[fd / 32] |= 1u << (fd % 32);
+    t->fd_max = fd + 1;
+  }
 }
 
 struct file * process_file_get(int fd) {
@@ -640,26 +735,26 @@ struct file * process_file_get(int fd) {
 }
 
 void process_file_close(int fd) {
-  int i;
   struct thread* t = thread_current();
+  if(fd < 2 || fd >= t->fd_max) return;
   struct file * file = t->FD_table[fd];
   if (file == NULL) return;
-  if(fd >= 2 && fd < t->fd_max) {
-    file_close(file);
-    t->FD_table[fd] = NULL;
-    for(i = fd; i < t->fd_max-1; i++)
-      t->FD_table[i] = t->FD_table[i+1];
+
+  file_close(file);
+  t->FD_table[fd] = NULL;
+  t->fd_used[fd / 32] &= ~(1u << (fd % 32));
+  if(fd < t->fd_hint)
+    t->fd_hint = fd;
+  while(t->fd_max > 2 && t->FD_table[t->fd_max - 1] == NULL)
     t->fd_max--;
-  }
-  else return;
 }
 
 bool handle_mm_fault(struct vm_entry * vme)
 { 
   if (vme == NULL) exit(-1);
   struct frame *kaddr= frame_alloc(PAL_USER);
-  kaddr->vme=vme;
   if(kaddr==NULL) return false;
+  kaddr->vme=vme;
   bool success, loaded;
 
   switch (vme->type)
@@ -671,7 +766,14 @@ bool handle_mm_fault(struct vm_entry * vme)
       success=load_file(kaddr->faddr, vme);
       break;
     case VM_ANON:
+      //a heap page that was never evicted has nothing in swap
+      if(vme->swap_slot == SWAP_NONE) {
+        memset(kaddr->faddr, 0, PGSIZE);
+        success = true;
+        break;
+      }
       success = swap_in(vme->swap_slot, kaddr->faddr);
+      if(success) vme->swap_slot = SWAP_NONE;
       break;
     default:
       return false;
@@ -685,6 +787,7 @@ bool handle_mm_fault(struct vm_entry * vme)
       frame_dealloc(kaddr->faddr);
       pagedir_clear_page(thread_current()->pagedir,vme->vaddr);
       return false;   }
+    frame_unpin(kaddr);
   }
   else {
     
@@ -707,7 +810,7 @@ bool expand_stack(void *addr) {
     f=frame_alloc(PAL_USER|PAL_ZERO);
     if(!f) return false;
     if(!install_page(pg_round_down(addr), f->faddr, 1)) {
-      frame_dealloc(f);
+      frame_dealloc(f->faddr);
       return false;
     }
     struct vm_entry * v = malloc(sizeof(struct vm_entry));
@@ -716,11 +819,41 @@ bool expand_stack(void *addr) {
     v->vaddr = pg_round_down(addr);
     v->writable = true;
     v->is_loaded = true;
+    v->swap_slot = SWAP_NONE;
+    v->ksm = NULL;
     f->vme = v;
     if(!vm_insert_vme(&thread_current()->vm, v))
-     frame_dealloc(f);
+     frame_dealloc(f->faddr);
+    else
+     frame_unpin(f);
    }
    return true;
   }
   return false;
-}
\ No newline at end of file
+}
+
+/*-----------------Heap pages--------------------*/
+//heap pages get their vm_entry on first touch, so sbrk() only moves the break.
+//returns the vm_entry for ADDR if it is in an untouched heap page, else NULL
+struct vm_entry * heap_vme(void *addr) {
+  struct thread * t = thread_current();
+  void * page = pg_round_down(addr);
+
+  if(page < t->heap_start || page >= pg_round_up(t->heap_end))
+    return NULL;
+  if(vm_find_vme(page)!=NULL)
+    return NULL;
+  struct vm_entry * v = calloc(1, sizeof(struct vm_entry));
+  if(v==NULL) return NULL;
+  v->type = VM_ANON;
+  v->vaddr = page;
+  v->writable = true;
+  v->is_loaded = false;
+  v->swap_slot = SWAP_NONE;
+  v->ksm = NULL;
+  if(!vm_insert_vme(&t->vm, v)) {
+    free(v);
+    return NULL;
+  }
+  return v;
+}
@@ -20,5 +20,6 @@ void process_file_close(int fd);
 struct file * process_file_get(int fd);
 bool handle_mm_fault(struct vm_entry * vme);
 bool expand_stack(void *addr) ;
+struct vm_entry * heap_vme(void *addr);
 
 #endif /* userprog/process.h */
@@ -0,0 +1,72 @@
+#include "userprog/shared-page.h"
+#include <debug.h>
+#include <shared-page.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "userprog/pagedir.h"
+
+/* The page, shared by the kernel and every user process. */
+static struct shared_page *shared_page;
+
+static void begin_update (void);
+static void end_update (void);
+
+/* Allocates the shared page. */
+void
+shared_page_init (void) 
+{
+  shared_page = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+  shared_page->timer_freq = TIMER_FREQ;
+}
+
+/* Maps the shared page read-only into page directory PD at
+   SHARED_PAGE_VADDR.  Returns true if successful, false if
+   memory allocation failed. */
+bool
+shared_page_map (uint32_t *pd) 
+{
+  return pagedir_set_page (pd, (void *) SHARED_PAGE_VADDR, shared_page, false);
+}
+
+/* Publishes the current tick count.  Called from the timer
+   interrupt handler. */
+void
+shared_page_tick (int64_t ticks) 
+{
+  if (shared_page == NULL)
+    return;
+  begin_update ();
+  shared_page->ticks = ticks;
+  end_update ();
+}
+
+/* Adds DELTA to the count of running user processes. */
+void
+shared_page_add_process (int delta) 
+{
+  enum intr_level old_level = intr_disable ();
+  begin_update ();
+  shared_page->process_cnt += delta;
+  end_update ();
+  intr_set_level (old_level);
+}
+
+/* Marks the start of an update.  Interrupts must be off, so
+   that updates do not nest. */
+static void
+begin_update (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  shared_page->seq++;
+  barrier ();
+}
+
+/* Marks the end of an update. */
+static void
+end_update (void) 
+{
+  barrier ();
+  shared_page->seq++;
+}
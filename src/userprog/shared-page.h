@@ -0,0 +1,12 @@
+#ifndef USERPROG_SHARED_PAGE_H
+#define USERPROG_SHARED_PAGE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+void shared_page_init (void);
+bool shared_page_map (uint32_t *pd);
+void shared_page_tick (int64_t ticks);
+void shared_page_add_process (int delta);
+
+#endif /* userprog/shared-page.h */
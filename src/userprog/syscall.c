@@ -1,33 +1,63 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
 #include <syscall-nr.h>
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/malloc.h"
 #include "threads/thread.h"
 #include "process.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
+#include "filesys/pipe.h"
 #include "vm/page.h"
 #include <string.h>
 #include "threads/vaddr.h"
 #include "vm/frame.h"
+#include "vm/ksm.h"
+#include "userprog/tss.h"
+#include "userprog/aio.h"
+#include "devices/tty.h"
+#include "userprog/poll.h"
 
 #define STACK_END 0x8048000
 #define STACK_BASE 0xc0000000
 #define MAX_STACK_SIZE (1 << 23)
+#define MAX_HEAP_SIZE (1 << 26)
 
 static void syscall_handler(struct intr_frame *);
+static void heap_release(uint8_t *start, uint8_t *end);
+void syscall_sysenter(void);
 
+/* If the CPU has SYSENTER, user programs use it instead of
+   int $0x30 (see lib/user/syscall.c).  SYSENTER loads ESP from an
+   MSR, which is pointed at the TSS's esp0 so that the entry stub
+   can pick up the current thread's kernel stack from there. */
 void syscall_init(void)
 {
   lock_init(&filesys_lock);
   intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall");
+  if (cpu_has_sysenter()) {
+    wrmsr(MSR_SYSENTER_CS, SEL_KCSEG);
+    wrmsr(MSR_SYSENTER_ESP, (uint32_t) tss_esp0());
+    wrmsr(MSR_SYSENTER_EIP, (uint32_t) syscall_sysenter);
+  }
 }
 
 static void
-syscall_handler(struct intr_frame *f UNUSED)
+syscall_handler(struct intr_frame *f)
+{
+  f->eax = syscall_dispatch(f->esp);
+}
+
+/* Runs the system call whose number and arguments are on the user
+   stack at SP and returns its result.  Reached from both the
+   int $0x30 handler and the SYSENTER entry in sysenter.S. */
+int
+syscall_dispatch(uint32_t *sp)
 {
-  int argv[3];
-  uint32_t *sp = f->esp;
+  int argv[4];
+  int ret = 0;
   check_user_addr((void *)sp);
   int syscall_number = *sp;
 
@@ -43,35 +73,35 @@ syscall_handler(struct intr_frame *f UNUSED)
     break;
   case SYS_EXEC:
     get_arg(sp, argv, 1);
-    f->eax = exec((const char *)argv[0]);
+    ret = exec((const char *)argv[0]);
     break;
   case SYS_WAIT:
     get_arg(sp, argv, 1);
-    f->eax = wait((pid_t)argv[0]);
+    ret = wait((pid_t)argv[0]);
     break;
   case SYS_CREATE:
     get_arg(sp, argv, 2);
-    f->eax = create_file(argv[0], argv[1]);
+    ret = create_file(argv[0], argv[1]);
     break;
   case SYS_REMOVE:
     get_arg(sp, argv, 1);
-    f->eax = remove_file(argv[0]);
+    ret = remove_file(argv[0]);
     break;
   case SYS_OPEN:
     get_arg(sp, argv, 1);
-    f->eax = open(argv[0]);
+    ret = open(argv[0]);
     break;
   case SYS_FILESIZE:
     get_arg(sp, argv, 1);
-    f->eax = filesize(argv[0]);
+    ret = filesize(argv[0]);
     break;
   case SYS_READ:
     get_arg(sp, argv, 3);
-    f->eax = read(argv[0], argv[1], argv[2]);
+    ret = read(argv[0], argv[1], argv[2]);
     break;
   case SYS_WRITE:
     get_arg(sp, argv, 3);
-    f->eax = write(argv[0], argv[1], argv[2]);
+    ret = write(argv[0], argv[1], argv[2]);
     break;
   case SYS_SEEK:
     get_arg(sp, argv, 2);
@@ -79,7 +109,7 @@ syscall_handler(struct intr_frame *f UNUSED)
     break;
   case SYS_TELL:
     get_arg(sp, argv, 1);
-    f->eax = tell(argv[0]);
+    ret = tell(argv[0]);
     break;
   case SYS_CLOSE:
     get_arg(sp, argv, 1);
@@ -87,7 +117,7 @@ syscall_handler(struct intr_frame *f UNUSED)
     break;
   case SYS_MMAP:
     get_arg(sp,argv,2);
-    f->eax=mmap(argv[0],argv[1]);
+    ret = mmap(argv[0],argv[1]);
     break;
 
   case SYS_MUNMAP:
@@ -95,7 +125,68 @@ syscall_handler(struct intr_frame *f UNUSED)
     munmap(argv[0]);
     break;
 
+  case SYS_PREAD:
+    get_arg(sp, argv, 4);
+    ret = pread(argv[0], (void *)argv[1], argv[2], argv[3]);
+    break;
+  case SYS_PWRITE:
+    get_arg(sp, argv, 4);
+    ret = pwrite(argv[0], (void *)argv[1], argv[2], argv[3]);
+    break;
+  case SYS_READV:
+    get_arg(sp, argv, 3);
+    ret = readv(argv[0], (const struct iovec *)argv[1], argv[2]);
+    break;
+  case SYS_WRITEV:
+    get_arg(sp, argv, 3);
+    ret = writev(argv[0], (const struct iovec *)argv[1], argv[2]);
+    break;
+  case SYS_COPY_FILE_RANGE:
+    get_arg(sp, argv, 3);
+    ret = copy_file_range(argv[0], argv[1], argv[2]);
+    break;
+  case SYS_URING_SETUP:
+    get_arg(sp, argv, 1);
+    ret = uring_setup((struct uring *)argv[0]);
+    break;
+  case SYS_URING_ENTER:
+    get_arg(sp, argv, 1);
+    ret = uring_enter(argv[0]);
+    break;
+  case SYS_AIO_READ:
+    get_arg(sp, argv, 4);
+    ret = aio_submit(argv[0], (void *)argv[1], argv[2], argv[3], false);
+    break;
+  case SYS_AIO_WRITE:
+    get_arg(sp, argv, 4);
+    ret = aio_submit(argv[0], (void *)argv[1], argv[2], argv[3], true);
+    break;
+  case SYS_AIO_WAIT:
+    get_arg(sp, argv, 1);
+    ret = aio_wait(argv[0]);
+    break;
+  case SYS_AIO_POLL:
+    ret = aio_poll();
+    break;
+  case SYS_PIPE:
+    get_arg(sp, argv, 1);
+    ret = pipe((int *)argv[0]);
+    break;
+  case SYS_SBRK:
+    get_arg(sp, argv, 1);
+    ret = (int)sbrk(argv[0]);
+    break;
+  case SYS_TTY_MODE:
+    get_arg(sp, argv, 1);
+    ret = tty_mode(argv[0]);
+    break;
+  case SYS_POLL:
+    get_arg(sp, argv, 3);
+    ret = poll((struct pollfd *)argv[0], argv[1], argv[2]);
+    break;
+
   }
+  return ret;
 }
 
 void halt()
@@ -152,7 +243,6 @@ int open(const char *file)
   check_valid_string(file);
   if (file == NULL)
     exit(-1);
-  int fd_cnt = thread_current()->fd_max;
   lock_acquire(&filesys_lock);
   f = filesys_open(file);
   lock_release(&filesys_lock);
@@ -164,7 +254,9 @@ int open(const char *file)
     file_deny_write(f);
 
   int fd = process_file_add(f);
-  return fd_cnt;
+  if (fd == -1)
+    file_close(f);
+  return fd;
 }
 
 int filesize(int fd)
@@ -180,29 +272,19 @@ int read(int fd, void *buffer, unsigned size)
 {
   check_valid_buffer(buffer, size, true);
   int read_byte;
-  int i;
+  struct file *file = NULL;
 
-  lock_acquire(&filesys_lock);
+  //console input may wait for a line to be typed, so it must not hold up the file system
   if (fd == 0)
-  {
-    for (i = 0; i < size; i++)
-    {
-      ((char *)buffer)[i] = input_getc();
-      if (((char *)buffer)[i] == '\0')
-        break;
-    }
-    read_byte = i + 1;
-  }
-  else
-  {
-    struct file *file = process_file_get(fd);
-    if (file == NULL)
-    {
-      lock_release(&filesys_lock);
-      return -1;
-    }
-    read_byte = file_read(file, buffer, size);
-  }
+    return tty_read(buffer, size);
+  if ((file = process_file_get(fd)) == NULL)
+    return -1;
+  //a pipe may wait for another process, which must be able to use the file system
+  if (file_is_pipe(file))
+    return file_read(file, buffer, size);
+
+  lock_acquire(&filesys_lock);
+  read_byte = file_read(file, buffer, size);
 
   lock_release(&filesys_lock);
   return read_byte;
@@ -213,28 +295,280 @@ int write(int fd, void *buffer, unsigned size)
   check_valid_buffer(buffer, size, false);
   int write_byte;
 
+  //the console has its own lock, so printing doesn't hold up file I/O
   if (fd == 1)
   {
-    lock_acquire(&filesys_lock);
     putbuf(buffer, size);
-    lock_release(&filesys_lock);
     return size;
   }
   else
   {
-    lock_acquire(&filesys_lock);
     struct file *file = process_file_get(fd);
     if (file == NULL)
-    {
-      lock_release(&filesys_lock);
       return -1;
-    }
+    if (file_is_pipe(file))
+      return file_write(file, buffer, size);
+    lock_acquire(&filesys_lock);
     write_byte = file_write(file, buffer, size);
     lock_release(&filesys_lock);
     return write_byte;
   }
 }
 
+//create a pipe and store its read and write fds in FDS[0] and FDS[1]
+int pipe(int *fds)
+{
+  struct pipe *p;
+  struct file *in, *out;
+
+  check_valid_buffer(fds, 2 * sizeof *fds, true);
+  p = pipe_create();
+  if (p == NULL)
+    return -1;
+  in = file_open_pipe(p, false);
+  if (in == NULL)
+    pipe_close(p, false);
+  out = file_open_pipe(p, true);
+  if (out == NULL)
+    pipe_close(p, true);
+  if (in == NULL || out == NULL) {
+    file_close(in);
+    file_close(out);
+    return -1;
+  }
+
+  fds[0] = process_file_add(in);
+  if (fds[0] == -1) {
+    file_close(in);
+    file_close(out);
+    return -1;
+  }
+  fds[1] = process_file_add(out);
+  if (fds[1] == -1) {
+    process_file_close(fds[0]);
+    file_close(out);
+    return -1;
+  }
+  return 0;
+}
+
+int pread(int fd, void *buffer, unsigned size, unsigned offset)
+{
+  check_valid_buffer(buffer, size, true);
+  if (fd < 2 || (off_t) offset < 0)
+    return -1;
+
+  lock_acquire(&filesys_lock);
+  struct file *file = process_file_get(fd);
+  int read_byte = file != NULL ? file_read_at(file, buffer, size, offset) : -1;
+  lock_release(&filesys_lock);
+  return read_byte;
+}
+
+int pwrite(int fd, const void *buffer, unsigned size, unsigned offset)
+{
+  check_valid_buffer((void *)buffer, size, false);
+  if (fd < 2 || (off_t) offset < 0)
+    return -1;
+
+  lock_acquire(&filesys_lock);
+  struct file *file = process_file_get(fd);
+  int write_byte = file != NULL ? file_write_at(file, buffer, size, offset) : -1;
+  lock_release(&filesys_lock);
+  return write_byte;
+}
+
+/* Copies IOVCNT iovecs from user memory at UIOV into KIOV,
+   checking the array and then each buffer once, so that the
+   transfer itself needs no further checks.  Returns false if
+   IOVCNT is out of range. */
+static bool copy_iovecs(const struct iovec *uiov, int iovcnt,
+                        struct iovec *kiov, bool to_write)
+{
+  int i;
+
+  if (iovcnt < 0 || iovcnt > IOV_MAX)
+    return false;
+  if (iovcnt == 0)
+    return true;
+  check_valid_buffer((void *)uiov, iovcnt * sizeof *uiov, false);
+  memcpy(kiov, uiov, iovcnt * sizeof *uiov);
+  //an empty entry is never touched, so its base may be anything
+  for (i = 0; i < iovcnt; i++)
+    if (kiov[i].iov_len != 0)
+      check_valid_buffer(kiov[i].iov_base, kiov[i].iov_len, to_write);
+  return true;
+}
+
+int readv(int fd, const struct iovec *uiov, int iovcnt)
+{
+  struct iovec iov[IOV_MAX];
+  struct file *file = NULL;
+  bool is_pipe;
+  int total = 0, i;
+
+  if (!copy_iovecs(uiov, iovcnt, iov, true))
+    return -1;
+  if (fd != 0 && (file = process_file_get(fd)) == NULL)
+    return -1;
+  is_pipe = file != NULL && file_is_pipe(file);
+
+  //console input may wait for a line to be typed, so it must not hold up the file system
+  if (!is_pipe && fd != 0)
+    lock_acquire(&filesys_lock);
+  for (i = 0; i < iovcnt; i++)
+  {
+    int n = fd == 0 ? (int) tty_read(iov[i].iov_base, iov[i].iov_len)
+                    : file_read(file, iov[i].iov_base, iov[i].iov_len);
+    if (n < 0) {
+      //the wrong end of a pipe
+      total = -1;
+      break;
+    }
+    total += n;
+    //short read: end of file, the end of a console line, or a pipe with nothing more for now
+    if ((size_t) n < iov[i].iov_len)
+      break;
+  }
+  if (!is_pipe && fd != 0)
+    lock_release(&filesys_lock);
+  return total;
+}
+
+int writev(int fd, const struct iovec *uiov, int iovcnt)
+{
+  struct iovec iov[IOV_MAX];
+  struct file *file = NULL;
+  bool is_pipe;
+  int total = 0, i;
+
+  if (!copy_iovecs(uiov, iovcnt, iov, false))
+    return -1;
+  if (fd != 1 && (file = process_file_get(fd)) == NULL)
+    return -1;
+  //neither pipes nor the console need the file system lock
+  is_pipe = file != NULL && file_is_pipe(file);
+
+  if (!is_pipe && fd != 1)
+    lock_acquire(&filesys_lock);
+  for (i = 0; i < iovcnt; i++)
+  {
+    int n;
+    if (fd == 1) {
+      putbuf(iov[i].iov_base, iov[i].iov_len);
+      n = iov[i].iov_len;
+    }
+    else
+      n = file_write(file, iov[i].iov_base, iov[i].iov_len);
+    if (n < 0) {
+      //the wrong end of a pipe
+      total = -1;
+      break;
+    }
+    total += n;
+    if ((size_t) n < iov[i].iov_len)
+      break;
+  }
+  if (!is_pipe && fd != 1)
+    lock_release(&filesys_lock);
+  return total;
+}
+
+//copy LENGTH bytes between the current positions of two files without
+//passing through user memory
+int copy_file_range(int fd_in, int fd_out, unsigned length)
+{
+  if (fd_in < 2 || fd_out < 2 || (off_t) length < 0)
+    return -1;
+
+  lock_acquire(&filesys_lock);
+  struct file *in = process_file_get(fd_in);
+  struct file *out = process_file_get(fd_out);
+  int copied = -1;
+  //pipes could block with filesys_lock held
+  if (in != NULL && out != NULL && !file_is_pipe(in) && !file_is_pipe(out))
+    copied = file_copy(out, in, length);
+  lock_release(&filesys_lock);
+  return copied;
+}
+
+/* Registers RING, a page-aligned struct uring in user memory,
+   for uring_enter(), and empties both of its rings.  A null RING
+   unregisters the current one.  The ring is checked here, once,
+   rather than on every operation. */
+int uring_setup(struct uring *ring)
+{
+  if (ring != NULL) {
+    if (pg_ofs(ring) != 0)
+      return -1;
+    check_valid_buffer(ring, sizeof *ring, true);
+    ring->sq_head = ring->sq_tail = 0;
+    ring->cq_head = ring->cq_tail = 0;
+  }
+  thread_current()->uring = ring;
+  return 0;
+}
+
+//run one submission the way the matching system call would
+static int uring_run(const struct uring_sqe *sqe)
+{
+  switch (sqe->op)
+  {
+  case URING_NOP:
+    return 0;
+  case URING_READ:
+    return read(sqe->fd, sqe->addr, sqe->len);
+  case URING_WRITE:
+    return write(sqe->fd, sqe->addr, sqe->len);
+  case URING_SEEK:
+    seek(sqe->fd, sqe->len);
+    return 0;
+  case URING_OPEN:
+    return open(sqe->addr);
+  case URING_CLOSE:
+    close(sqe->fd);
+    return 0;
+  default:
+    return -1;
+  }
+}
+
+/* Runs up to TO_SUBMIT operations from the registered ring, in
+   order, posting a completion for each.  Stops early when the
+   submission ring runs dry or the completion ring fills.
+   Returns the number of operations run, or -1 if no ring is
+   registered. */
+int uring_enter(unsigned to_submit)
+{
+  struct uring *ring = thread_current()->uring;
+  uint32_t head, tail;
+  unsigned done;
+
+  if (ring == NULL)
+    return -1;
+  //one lookup per batch, in case the ring was unmapped since setup
+  check_user_addr(ring);
+
+  head = ring->sq_head;
+  tail = ring->sq_tail;
+  for (done = 0; done < to_submit && head != tail; done++) {
+    //copy the entry so the process cannot change it under us
+    struct uring_sqe sqe = ring->sq[head % URING_ENTRIES];
+    struct uring_cqe *cqe;
+    int res;
+
+    if (ring->cq_tail - ring->cq_head >= URING_ENTRIES)
+      break;
+    res = uring_run(&sqe);
+    cqe = &ring->cq[ring->cq_tail % URING_ENTRIES];
+    cqe->user_data = sqe.user_data;
+    cqe->res = res;
+    ring->cq_tail++;
+    ring->sq_head = ++head;
+  }
+  return done;
+}
+
 void seek(int fd, unsigned position)
 {
   struct file *file = process_file_get(fd);
@@ -268,6 +602,8 @@ struct vm_entry * check_user_addr(void *addr)
   }
 
   struct vm_entry * vme=vm_find_vme(addr);
+  if(vme==NULL)
+    vme=heap_vme(addr);
   
   if(vme==NULL) 
     {
@@ -280,30 +616,36 @@ struct vm_entry * check_user_addr(void *addr)
   return vme;
   
 }
+//check [buffer, buffer+size] once per page rather than once per byte
 void check_valid_buffer (void * buffer, unsigned size, bool to_write)
 {
+  void * page;
+
   check_user_addr(buffer);
   check_user_addr(buffer+size);
-  unsigned int i=0;
-  for (i = 0; i <= size; i++)
+  for (page = pg_round_down(buffer); page <= buffer+size; page += PGSIZE)
   { 
-    struct vm_entry * vme=check_user_addr(buffer+i);
+    struct vm_entry * vme=check_user_addr(page < buffer ? buffer : page);
     if(to_write && vme->writable==false)  
       {exit(-1);}
   }
 }
 
+//check each page the string touches once, and scan the rest of
+//that page for the terminator with strnlen(), which never reads
+//past the page
 void check_valid_string(const void * str)
 {
-  unsigned int i=0;
+  const char *p = str;
   while(1)
   {
-    check_user_addr(str+i);
+    size_t left;
 
-    if(*(char *)(str+i)=='\0') break;
-    i++;
+    check_user_addr((void *)p);
+    left = (const char *)pg_round_down(p) + PGSIZE - p;
+    if (strnlen(p, left) < left) break;
+    p += left;
   }
-  return;
 }
 
 void get_arg(int *esp, int *argv, int argc)
@@ -336,6 +678,10 @@ int mmap(int fd, void * addr)
   {
     if(vm_find_vme(temp)!=NULL) return -1;
   }
+  //untouched heap pages have no vm_entry yet, so check the heap too
+  if(addr < pg_round_up(thread_current()->heap_end)
+     && addr+size > thread_current()->heap_start)
+    return -1;
 
 
   struct mmap_file * mapfile = malloc(sizeof(struct mmap_file));
@@ -360,6 +706,8 @@ int mmap(int fd, void * addr)
     vme->offset= offset;
     vme-> writable= true;
     vme-> is_loaded = false;
+    vme-> swap_slot = SWAP_NONE;
+    vme-> ksm = NULL;
    
     if (size<PGSIZE) vme->read_bytes= size;
     else vme->read_bytes=PGSIZE;
@@ -382,6 +730,86 @@ return mapfile->mapid;
 }
 
 
+/* Moves the program break by INCREMENT bytes and returns the old
+   break, or (void *) -1 if that would take it below the start of
+   the heap, into another mapping, or more than MAX_HEAP_SIZE above
+   the start of the heap.  Nothing is allocated here: a heap page is
+   given its vm_entry and a zeroed frame when first touched (see
+   heap_vme()).  Pages left wholly above a lowered break are
+   released at once. */
+void *sbrk(int increment)
+{
+  struct thread *t = thread_current();
+  uint8_t *old_brk = t->heap_end;
+  uint8_t *new_brk = old_brk + increment;
+  uint8_t *page;
+
+  if (increment < 0 ? new_brk < (uint8_t *)t->heap_start || new_brk > old_brk
+                    : new_brk < old_brk
+                      || new_brk > (uint8_t *)t->heap_start + MAX_HEAP_SIZE)
+    return (void *)-1;
+
+  for (page = pg_round_up(old_brk); page < new_brk; page += PGSIZE)
+    if (vm_find_vme(page) != NULL)
+      return (void *)-1;
+
+  if (pg_round_up(new_brk) < pg_round_up(old_brk)) {
+    //pending asynchronous I/O may have pages of the heap pinned
+    aio_drain();
+    heap_release(pg_round_up(new_brk), pg_round_up(old_brk));
+  }
+  t->heap_end = new_brk;
+  return old_brk;
+}
+
+//switch console input between line-at-a-time and raw mode, returning the old mode
+int tty_mode(int mode)
+{
+  if (mode != TTY_CANONICAL && mode != TTY_RAW)
+    return -1;
+  return tty_set_mode(mode);
+}
+
+//wait for any of NFDS descriptors to become ready, working on a kernel copy of FDS
+int poll(struct pollfd *ufds, unsigned nfds, int timeout)
+{
+  struct pollfd fds[POLL_MAX];
+  int ready;
+
+  if (nfds > POLL_MAX)
+    return -1;
+  //poll(NULL, 0, timeout) just sleeps, so there is nothing to copy
+  if (nfds == 0)
+    return poll_fds(fds, 0, timeout);
+  check_valid_buffer(ufds, nfds * sizeof *ufds, true);
+  memcpy(fds, ufds, nfds * sizeof *ufds);
+  ready = poll_fds(fds, nfds, timeout);
+  memcpy(ufds, fds, nfds * sizeof *ufds);
+  return ready;
+}
+
+//drop the heap pages in [start, end): their frames, swap slots and vm_entries
+static void heap_release(uint8_t *start, uint8_t *end)
+{
+  uint32_t *pd = thread_current()->pagedir;
+  uint8_t *page;
+
+  for (page = start; page < end; page += PGSIZE) {
+    struct vm_entry *vme = vm_find_vme(page);
+    if (vme == NULL)
+      continue;
+    if (vme->is_loaded) {
+      if (vme->ksm != NULL)
+        ksm_put(vme->ksm);
+      else
+        frame_dealloc(pagedir_get_page(pd, page));
+      pagedir_clear_page(pd, page);
+    }
+    swap_free(vme->swap_slot);
+    vm_delete_vme(&thread_current()->vm, vme);
+  }
+}
+
 void munmap(int mapping)
 {
   struct list_elem * e;
@@ -392,12 +820,16 @@ void munmap(int mapping)
     temp = list_entry (e, struct mmap_file, elem);
     if (mapping==CLOSE_ALL) 
     {     
-      do_munmap(temp);
+      //process exit: frames were collected already and vm_destroy frees the vmes
+      mmap_writeback(temp);
+      file_close(temp->file);
       e=list_remove(e);
       free(temp);
     }
     else if (temp->mapid == mapping) 
     {
+      //pending asynchronous I/O may have pages of the mapping pinned
+      aio_drain();
       do_munmap(temp);
       e=list_remove(e);
       free(temp);
@@ -407,21 +839,56 @@ void munmap(int mapping)
 
 }
 
+/* Writes the dirty resident pages of MMAP_FILE back to the file.
+   vme_list is in file offset order and the pages are contiguous
+   in user memory, so each run of dirty pages goes out as one
+   write, all under a single filesys_lock acquisition. */
+void mmap_writeback(struct mmap_file * mmap_file)
+{
+  uint32_t * pd = thread_current()->pagedir;
+  struct vm_entry * first = NULL;
+  struct list_elem * e;
+  bool locked = lock_held_by_current_thread(&filesys_lock);
+  size_t len = 0;
+
+  if (!locked)
+    lock_acquire(&filesys_lock);
+  for (e=list_begin(&(mmap_file->vme_list)); ; e=list_next(e))
+  {
+    struct vm_entry * vme = NULL;
+    bool dirty = false;
+    if (e != list_end(&mmap_file->vme_list)) {
+      vme = list_entry (e, struct vm_entry, mmap_elem);
+      dirty = vme->is_loaded && pagedir_is_dirty(pd, vme->vaddr);
+    }
+    //end of a run
+    if (first != NULL && (!dirty || vme->offset != first->offset + len)) {
+      file_write_at(mmap_file->file, first->vaddr, len, first->offset);
+      first = NULL;
+      len = 0;
+    }
+    if (dirty) {
+      if (first == NULL)
+        first = vme;
+      len += vme->read_bytes;
+    }
+    if (vme == NULL)
+      break;
+  }
+  if (!locked)
+    lock_release(&filesys_lock);
+}
+
 void do_munmap(struct mmap_file * mmap_file)
 {
   struct list_elem * e;
+
+  mmap_writeback(mmap_file);
   for (e=list_begin(&(mmap_file->vme_list)); e!= list_end(&mmap_file->vme_list);)
   {
     struct vm_entry * vme = list_entry (e, struct vm_entry, mmap_elem);
     if (vme->is_loaded)
     {
-      if (pagedir_is_dirty(thread_current()->pagedir, vme->vaddr)){
-      lock_acquire(&filesys_lock);
-      file_write_at(vme->file, vme->vaddr, vme->read_bytes,vme->offset);
-      lock_release(&filesys_lock);
-
-      }
-      
       frame_dealloc(pagedir_get_page(thread_current()->pagedir,vme->vaddr));
       pagedir_clear_page(thread_current()->pagedir,vme->vaddr);
     }       
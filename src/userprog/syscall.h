@@ -3,6 +3,9 @@
 
 
 #include <stdbool.h>
+#include <iovec.h>
+#include <uring.h>
+#include <poll.h>
 #include "vm/page.h"
 #include "vm/frame.h"
 #define STACK_END 0x8048000
@@ -13,6 +16,7 @@ struct lock filesys_lock;
 
 
 void syscall_init (void);
+int syscall_dispatch(uint32_t *sp);
 struct vm_entry * check_user_addr(void *addr);
 
 void check_valid_buffer(void * buffer, unsigned size, bool to_write);
@@ -32,10 +36,22 @@ int write(int fd, void *buffer, unsigned size);
 void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
-
-
+int pread(int fd, void *buffer, unsigned size, unsigned offset);
+int pwrite(int fd, const void *buffer, unsigned size, unsigned offset);
+int readv(int fd, const struct iovec *iov, int iovcnt);
+int writev(int fd, const struct iovec *iov, int iovcnt);
+int copy_file_range(int fd_in, int fd_out, unsigned length);
+int pipe(int *fds);
+int tty_mode(int mode);
+int poll(struct pollfd *fds, unsigned nfds, int timeout);
+int uring_setup(struct uring *ring);
+int uring_enter(unsigned to_submit);
+
+
+void *sbrk(int increment);
 int mmap(int fd, void * addr);
 void munmap(int mapping);
+void mmap_writeback(struct mmap_file * mmap_file);
 void do_munmap(struct mmap_file * mmap_file);
 
 
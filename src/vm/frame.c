@@ -1,5 +1,60 @@
 #include "frame.h"
+#include <stdio.h>
 #include "vm/page.h"
+#include "vm/ksm.h"
+#include "threads/malloc.h"
+
+/* Page replacement is WSClock.  Each thread's vtime advances on
+   every timer tick it runs, and the clock hand stamps a frame with
+   its owner's vtime whenever it finds the frame accessed.  A frame
+   whose stamp is more than frame_ws_window ticks old has left its
+   owner's working set: if it is clean it is evicted, if it is
+   dirty it is queued for the "writeback" thread and the hand moves
+   on looking for a clean victim.
+
+   Page-out daemon.  When the number of free user frames drops
+   below low_watermark, frame_alloc() wakes the "pageout" thread,
+   which evicts frames until high_watermark frames are free again.
+   Before going back to sleep it also queues a few dirty frames
+   ahead of the clock hand for writeback, so that most evictions
+   done in the fault path are clean drops. */
+#define WATERMARK_DIV 32        /* Low watermark is 1/32 of user pool. */
+#define PRECLEAN_CNT 16         /* Max frames pre-cleaned per wakeup. */
+#define DEFAULT_WS_WINDOW 20    /* Default working-set window. */
+
+int64_t frame_ws_window = DEFAULT_WS_WINDOW;
+
+static struct list_elem * frame_clock_head;
+
+/* Frames waiting for the writeback thread, and a condition
+   signaled each time a busy frame is released.  Both use
+   frame_lock. */
+static struct list writeback_queue;
+static struct semaphore writeback_sema;
+static struct condition frame_idle;
+
+static size_t low_watermark;
+static size_t high_watermark;
+static struct semaphore pageout_sema;
+static bool pageout_busy;
+
+/* Statistics. */
+static long long direct_reclaim_cnt;      /* Evictions in frame_alloc(). */
+static long long background_reclaim_cnt;  /* Evictions by the daemon. */
+static long long preclean_cnt;            /* Frames queued by the daemon. */
+static long long writeback_cnt;           /* Async writebacks completed. */
+
+static void pageout_daemon(void * aux);
+static void writeback_daemon(void * aux);
+static void queue_writeback(struct frame * f);
+static struct list_elem * clock_next(struct list_elem * e);
+static void frame_table_remove(struct frame * f);
+static struct frame * clock_select(void);
+static bool frame_needs_writeback(struct frame * f);
+static void frame_writeback(struct frame * f);
+static void frame_release(struct frame * f);
+static bool evict_one(void);
+static void preclean(void);
 
 
 void frame_table_init(void)
@@ -7,38 +62,56 @@ void frame_table_init(void)
   list_init(&frame_table);
   lock_init(&frame_lock);
   frame_clock_head=NULL;
+
+  low_watermark = palloc_pool_size(PAL_USER) / WATERMARK_DIV + 1;
+  high_watermark = low_watermark * 2;
+  sema_init(&pageout_sema, 0);
+  thread_create("pageout", PRI_DEFAULT, pageout_daemon, NULL);
+
+  list_init(&writeback_queue);
+  sema_init(&writeback_sema, 0);
+  cond_init(&frame_idle);
+  thread_create("writeback", PRI_DEFAULT, writeback_daemon, NULL);
 }
 
 
+//returned frame is pinned. caller must frame_unpin it once the page is installed
 struct frame * frame_alloc(enum palloc_flags flags)
 {
-	if(flags & PAL_USER == 0)
-	  return NULL;
-  
+  if((flags & PAL_USER) == 0)
+    return NULL;
+
   void * faddr = palloc_get_page(flags);
-  
-	//free physical memory가 없으면 evict하고 할당
+
+  //free physical memory가 없으면 evict하고 할당
   while(faddr==NULL) {
-		frame_evict(flags);
-		faddr = palloc_get_page(flags);
+    if(!frame_evict(flags))
+      thread_yield();
+    faddr = palloc_get_page(flags);
   }
-	//위에서 할당받은 physical memory에 대한 정보를 담는 frame 선언
+  //위에서 할당받은 physical memory에 대한 정보를 담는 frame 선언
   struct frame * f = malloc(sizeof(struct frame));
   if(f==NULL) {
     palloc_free_page(faddr);
     return f;
   }
   f->faddr=faddr;
+  f->vme=NULL;
   f->thread=thread_current();
-	
-  if(list_empty(&frame_table))
-  {
-    frame_clock_head=&(f->elem);
-  }
+  f->pinned=1;
+  f->busy=false;
+  f->last_used=f->thread->vtime;
 
-	//frame_table에 추가
-	lock_acquire(&frame_lock);
+  //frame_table에 추가
+  lock_acquire(&frame_lock);
   list_push_back(&frame_table, &(f->elem));
+  if(frame_clock_head==NULL)
+    frame_clock_head=&(f->elem);
+
+  if(!pageout_busy && palloc_free_cnt(PAL_USER) < low_watermark) {
+    pageout_busy=true;
+    sema_up(&pageout_sema);
+  }
   lock_release(&frame_lock);
 
   return f;
@@ -48,99 +121,388 @@ struct frame * frame_alloc(enum palloc_flags flags)
 //faddr인 frame 할당 해제하기
 void frame_dealloc(void * faddr)
 {
- 
+
   struct list_elem * e;
   struct frame *f;
+  lock_acquire(&frame_lock);
+ retry:
   for(e = list_begin(&frame_table); e != list_end(&frame_table); e = list_next(e))
   {
     f = list_entry(e, struct frame, elem);
-    if(f->faddr==faddr) 
+    if(f->faddr==faddr)
     {
-      //pagedir_clear_page(f->thread->pagedir, f->vme->vaddr);
+      //a busy frame may be merged away while we wait, so look it up again
+      if(f->busy) {
+        cond_wait(&frame_idle, &frame_lock);
+        goto retry;
+      }
+      frame_table_remove(f);
       palloc_free_page(f->faddr);
-      lock_acquire(&frame_lock);
-      list_remove(&(f->elem));
-      lock_release(&frame_lock);
       free(f);
       break;
     }
   }
+  lock_release(&frame_lock);
 
 }
 
-static struct list_elem* next_frame() {
-	struct list_elem* e;
-	struct frame* f;
-  lock_acquire(&frame_lock);
+void frame_unpin(struct frame * f)
+{
+  f->pinned--;
+}
 
+/* Pins the frame holding user page UPAGE of the current process,
+   faulting it in first if necessary, so that kernel threads can
+   do I/O on it through its kernel address.  A merged page is
+   given a private copy first, since it has no frame.  Pins nest;
+   each must be undone with frame_unpin_user().  Returns a null
+   pointer if UPAGE is not part of the process's memory or cannot
+   be loaded. */
+struct frame * frame_pin_user(void * upage)
+{
+  struct thread * t = thread_current();
+  struct vm_entry * vme = vm_find_vme(upage);
+  struct list_elem * e;
 
-	for(e = frame_clock_head; e != list_end(&frame_table); e = list_next(e)) {
-		f = list_entry(e, struct frame, elem);
-		if(pagedir_is_accessed(f->thread->pagedir, f->vme->vaddr)) 
-		  pagedir_set_accessed(f->thread->pagedir, f->vme->vaddr, false); 
-		else {
-      lock_release(&frame_lock);
-			return e;
-		}
-	}
+  if(vme==NULL)
+    return NULL;
+  for(;;) {
+    if(vme->ksm!=NULL && !ksm_unshare(vme))
+      return NULL;
+    if(!vme->is_loaded && !handle_mm_fault(vme))
+      return NULL;
 
-  if(e==list_end(&frame_table))
-  {
-	for(e = list_begin(&frame_table); e != frame_clock_head; e = list_next(e)) {
-		f = list_entry(e, struct frame, elem);
-		if(pagedir_is_accessed(f->thread->pagedir, f->vme->vaddr)) 
-			{ 
-        pagedir_set_accessed(f->thread->pagedir, f->vme->vaddr, false); 
+    //the page may be evicted or merged again before we get the lock, so check
+    lock_acquire(&frame_lock);
+    void * kpage = pagedir_get_page(t->pagedir, upage);
+    for(e = list_begin(&frame_table); kpage!=NULL && e != list_end(&frame_table);
+        e = list_next(e)) {
+      struct frame * f = list_entry(e, struct frame, elem);
+      if(f->faddr!=kpage)
+        continue;
+      if(f->busy) {
+        cond_wait(&frame_idle, &frame_lock);
+        break;
       }
-		else {
+      f->pinned++;
       lock_release(&frame_lock);
-			return e;
-		}
+      return f;
+    }
+    lock_release(&frame_lock);
+    thread_yield();
   }
+}
+
+//undo frame_pin_user(), possibly from another thread
+void frame_unpin_user(struct frame * f)
+{
+  lock_acquire(&frame_lock);
+  f->pinned--;
   lock_release(&frame_lock);
+}
+
+//mark F busy for a kernel daemon, so it is neither evicted nor freed.
+//false if F is in use elsewhere. frame_lock must be held
+bool frame_hold(struct frame * f)
+{
+  if(f->pinned || f->busy || f->vme==NULL || f->thread->pagedir==NULL)
+    return false;
+  f->busy=true;
+  return true;
+}
+
+//undo frame_hold(). frame_lock must be held
+void frame_unhold(struct frame * f)
+{
+  f->busy=false;
+  cond_broadcast(&frame_idle, &frame_lock);
+}
+
+//remove held frame F from frame_table and free it, leaving its page
+//to the caller. frame_lock must be held
+void frame_detach(struct frame * f)
+{
+  frame_table_remove(f);
+  cond_broadcast(&frame_idle, &frame_lock);
+  free(f);
+}
+
+/* Moves every frame owned by T from the frame table to FRAMES
+   in one sweep, for process teardown.  Frames some daemon is
+   still working on are waited for, so once this returns nothing
+   else touches T's pages or vm_entries.  The pages stay mapped
+   in T's page directory until frame_free_list(). */
+void frame_collect(struct thread * t, struct list * frames)
+{
+  struct list_elem * e, * next;
+  bool busy;
+
+  lock_acquire(&frame_lock);
+  do {
+    busy = false;
+    for(e = list_begin(&frame_table); e != list_end(&frame_table); e = next) {
+      struct frame * f = list_entry(e, struct frame, elem);
+      next = list_next(e);
+      if(f->thread!=t)
+        continue;
+      if(f->busy) {
+        busy = true;
+        continue;
+      }
+      frame_table_remove(f);
+      list_push_back(frames, &(f->elem));
+    }
+    if(busy)
+      cond_wait(&frame_idle, &frame_lock);
+  } while(busy);
+  lock_release(&frame_lock);
+}
+
+//free the frames and pages gathered by frame_collect()
+void frame_free_list(struct list * frames)
+{
+  while(!list_empty(frames)) {
+    struct frame * f = list_entry(list_pop_front(frames), struct frame, elem);
+    palloc_free_page(f->faddr);
+    free(f);
+  }
+}
+
+//evict one frame for frame_alloc. false if every frame is pinned
+bool frame_evict(enum palloc_flags flags UNUSED)
+{
+  if(!evict_one())
+    return false;
+  direct_reclaim_cnt++;
+  return true;
+}
+
+void frame_print_stats(void)
+{
+  printf("Frame: %lld direct reclaims, %lld background reclaims, "
+         "%lld pre-cleaned, %lld async writebacks\n",
+         direct_reclaim_cnt, background_reclaim_cnt, preclean_cnt,
+         writeback_cnt);
+}
+
+static void pageout_daemon(void * aux UNUSED)
+{
+  for(;;) {
+    sema_down(&pageout_sema);
+
+    while(palloc_free_cnt(PAL_USER) < high_watermark && evict_one())
+      background_reclaim_cnt++;
+    preclean();
+
+    lock_acquire(&frame_lock);
+    pageout_busy=false;
+    lock_release(&frame_lock);
+  }
+}
+
+static void writeback_daemon(void * aux UNUSED)
+{
+  struct frame * f;
+
+  for(;;) {
+    sema_down(&writeback_sema);
+
+    lock_acquire(&frame_lock);
+    f = list_entry(list_pop_front(&writeback_queue), struct frame, wb_elem);
+    lock_release(&frame_lock);
+
+    pagedir_set_dirty(f->thread->pagedir, f->vme->vaddr, false);
+    frame_writeback(f);
+    writeback_cnt++;
+
+    lock_acquire(&frame_lock);
+    frame_unhold(f);
+    lock_release(&frame_lock);
+  }
+}
+
+//hand F, already held, to the writeback thread. frame_lock must be held
+static void queue_writeback(struct frame * f)
+{
+  list_push_back(&writeback_queue, &(f->wb_elem));
+  sema_up(&writeback_sema);
+}
+
+//next element of the clock after E, wrapping around at the end
+static struct list_elem * clock_next(struct list_elem * e)
+{
+  e = list_next(e);
+  if(e==list_end(&frame_table))
+    e = list_begin(&frame_table);
   return e;
+}
+
+//remove F from frame_table, moving the clock hand off it. frame_lock must be held
+static void frame_table_remove(struct frame * f)
+{
+  if(frame_clock_head==&(f->elem)) {
+    frame_clock_head = clock_next(&(f->elem));
+    if(frame_clock_head==&(f->elem))
+      frame_clock_head=NULL;
   }
-  lock_release(&frame_lock);
-	return NULL;
+  list_remove(&(f->elem));
 }
 
-void  frame_evict(enum palloc_flags flags)
+/* Runs the WSClock hand over the frame table and returns the
+   first clean frame that has left its owner's working set,
+   queueing dirty ones for writeback on the way.  If a full pass
+   finds no such frame and queued no writeback, falls back to the
+   first evictable frame seen, preferring a clean one.  The frame
+   is returned held, so no other thread can pick it too and its
+   owner cannot tear it down under us.  Returns a null pointer if
+   nothing can be evicted right now.  frame_lock must be held. */
+static struct frame * clock_select(void)
 {
+  struct frame * clean = NULL, * dirty = NULL, * victim = NULL;
+  size_t n = 2 * list_size(&frame_table);
+  bool queued = false;
 
-  //printf("hello\n");
-  struct list_elem * e = next_frame();
-  if (e == NULL) {
-    return NULL;
+  for(; frame_clock_head!=NULL && n > 0; n--) {
+    struct frame * f = list_entry(frame_clock_head, struct frame, elem);
+    uint32_t * pd = f->thread->pagedir;
+    frame_clock_head = clock_next(frame_clock_head);
+
+    if(f->pinned || f->busy || f->vme==NULL || pd==NULL)
+      continue;
+    if(pagedir_is_accessed(pd, f->vme->vaddr)) {
+      pagedir_clear_accessed_lazy(pd, f->vme->vaddr);
+      f->last_used = f->thread->vtime;
+      continue;
+    }
+
+    bool needs_writeback = frame_needs_writeback(f);
+    if(f->thread->vtime - f->last_used <= frame_ws_window) {
+      if(!needs_writeback && clean==NULL)
+        clean = f;
+      else if(needs_writeback && dirty==NULL)
+        dirty = f;
+      continue;
+    }
+    if(needs_writeback) {
+      frame_hold(f);
+      queue_writeback(f);
+      queued = true;
+      continue;
+    }
+    victim = f;
+    break;
   }
+  //one TLB flush for all the accessed bits cleared above
+  pagedir_flush_lazy();
+
+  if(victim==NULL && !queued)
+    victim = clean!=NULL ? clean : dirty;
+  if(victim!=NULL)
+    frame_hold(victim);
+  return victim;
+}
+
+//true if F's contents are not in its backing store yet
+static bool frame_needs_writeback(struct frame * f)
+{
+  bool dirty = pagedir_is_dirty(f->thread->pagedir, f->vme->vaddr);
 
-  struct frame * f = list_entry(e, struct frame, elem);
-  switch (f->vme->type)
-  {    
+  switch(f->vme->type)
+  {
     case VM_BIN:
-      if(pagedir_is_dirty(f->thread->pagedir, f->vme->vaddr)) {
-        f->vme->type = VM_ANON;
-        f->vme->swap_slot = swap_out(f->faddr);
-      }
-      break;
     case VM_FILE:
-      if(pagedir_is_dirty(f->thread->pagedir, f->vme->vaddr)) {
-        lock_acquire(&filesys_lock);
-        file_write_at(f->vme->file, f->faddr, f->vme->read_bytes, f->vme->offset);
-        lock_release(&filesys_lock);
-      }
-      break;
-    case VM_ANON: 
-      f->vme->swap_slot = swap_out(f->faddr);
-      break;
+      return dirty;
+    default:
+      return dirty || f->vme->swap_slot==SWAP_NONE;
   }
-  frame_clock_head= list_remove(e);
-  
-  pagedir_clear_page(f->thread->pagedir, f->vme->vaddr);
-  palloc_free_page(f->faddr);
-  list_remove(&(f->elem));
+}
+
+//copy F to its backing store: the file for mmap pages, swap otherwise.
+//an anonymous page keeps its swap slot, so a later clean eviction is free.
+static void frame_writeback(struct frame * f)
+{
+  struct vm_entry * vme = f->vme;
+
+  if(vme->type==VM_FILE) {
+    if(lock_held_by_current_thread(&filesys_lock))
+      file_write_at(vme->file, f->faddr, vme->read_bytes, vme->offset);
+    else {
+      lock_acquire(&filesys_lock);
+      file_write_at(vme->file, f->faddr, vme->read_bytes, vme->offset);
+      lock_release(&filesys_lock);
+    }
+  }
+  else {
+    vme->type = VM_ANON;
+    if(vme->swap_slot==SWAP_NONE)
+      vme->swap_slot = swap_out(f->faddr);
+    else
+      vme->swap_slot = swap_rewrite(vme->swap_slot, f->faddr);
+  }
+}
+
+//evict F, which clock_select() has held for us
+static void frame_release(struct frame * f)
+{
+  uint32_t * pd = f->thread->pagedir;
+  void * vaddr = f->vme->vaddr;
+  void * faddr = f->faddr;
+
+  //clear the dirty bit before copying, so a write that races with the copy is noticed below
+  if(frame_needs_writeback(f)) {
+    pagedir_set_dirty(pd, vaddr, false);
+    frame_writeback(f);
+  }
+  pagedir_clear_page(pd, vaddr);
+  if(pagedir_is_dirty(pd, vaddr))
+    frame_writeback(f);
+
   f->vme->is_loaded = false;
-  free(f);
+  lock_acquire(&frame_lock);
+  frame_detach(f);
+  lock_release(&frame_lock);
+  palloc_free_page(faddr);
+}
+
+static bool evict_one(void)
+{
+  struct frame * f;
 
-  return;
+  lock_acquire(&frame_lock);
+  f = clock_select();
+  lock_release(&frame_lock);
+
+  if(f==NULL)
+    return false;
+  frame_release(f);
+  return true;
 }
 
+/* Queues up to PRECLEAN_CNT dirty frames just ahead of the
+   clock hand that have not been accessed recently for writeback,
+   so that when the hand reaches them they can be dropped without
+   any I/O. */
+static void preclean(void)
+{
+  struct list_elem * e;
+  size_t n, cnt = 0;
+
+  lock_acquire(&frame_lock);
+  e = frame_clock_head;
+  for(n = list_size(&frame_table); e!=NULL && n > 0 && cnt < PRECLEAN_CNT; n--) {
+    struct frame * f = list_entry(e, struct frame, elem);
+    e = clock_next(e);
+
+    if(!frame_hold(f))
+      continue;
+    if(pagedir_is_accessed(f->thread->pagedir, f->vme->vaddr)
+       || !frame_needs_writeback(f)) {
+      frame_unhold(f);
+      continue;
+    }
+    queue_writeback(f);
+    cnt++;
+  }
+  lock_release(&frame_lock);
+  preclean_cnt += cnt;
+}
@@ -14,18 +14,32 @@ struct frame
     void * faddr;
     struct vm_entry * vme;
     struct thread *thread;
+    int pinned;               /* Not to be evicted while nonzero. */
+    bool busy;                /* Held by the writeback or merge thread. */
+    int64_t last_used;        /* Owner's vtime when last seen accessed. */
     struct list_elem elem;
+    struct list_elem wb_elem; /* Element in the writeback queue. */
 };
 
 struct list frame_table;
-static struct frame * frame_clock_head;
 struct lock frame_lock;
 
+/* -wss: Working-set window, in ticks of the owner's vtime. */
+extern int64_t frame_ws_window;
+
 
 void frame_table_init(void);
 struct frame * frame_alloc(enum palloc_flags flags);
 void frame_dealloc(void * faddr);
-static struct list_elem* next_frame();
-void frame_evict(enum palloc_flags flags);
+void frame_unpin(struct frame * f);
+struct frame * frame_pin_user(void * upage);
+void frame_unpin_user(struct frame * f);
+bool frame_evict(enum palloc_flags flags);
+bool frame_hold(struct frame * f);
+void frame_unhold(struct frame * f);
+void frame_detach(struct frame * f);
+void frame_collect(struct thread * t, struct list * frames);
+void frame_free_list(struct list * frames);
+void frame_print_stats(void);
 
 #endif
@@ -0,0 +1,299 @@
+#include "vm/ksm.h"
+#include <hash.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+
+/* Same-page merging.
+
+   When enabled with -ksm, the "ksmd" thread wakes every
+   KSM_SLEEP_TICKS ticks and looks at the next KSM_SCAN_CNT frames
+   of the frame table.  Each anonymous frame is hashed.  If a
+   stable page with the same contents exists, the frame's user
+   mapping is pointed at it read-only and the frame is freed.
+   Otherwise the frame is remembered in a small direct-mapped
+   "unstable" table, and when a second frame with the same hash
+   turns up, the two are merged into a new stable page.
+
+   Stable pages are not in the frame table, so they are never
+   evicted.  A write to one faults, and ksm_unshare() gives the
+   writer a private copy. */
+
+#define KSM_SCAN_CNT 32         /* Frames looked at per wakeup. */
+#define KSM_SLEEP_TICKS 10      /* Ticks between wakeups. */
+#define UNSTABLE_CNT 256        /* Slots in the unstable table. */
+
+/* A page shared read-only by every vm_entry whose ksm member
+   points to it. */
+struct ksm_page
+  {
+    void *faddr;                /* Kernel virtual address of page. */
+    unsigned hash;              /* hash_bytes() of its contents. */
+    int refcnt;                 /* Number of user mappings. */
+    struct hash_elem elem;      /* Element in stable_pages. */
+  };
+
+bool ksm_enabled;
+
+static struct hash stable_pages;
+static struct lock ksm_lock;
+
+/* Unstable table, indexed by hash, reset at the start of each
+   pass over the frame table.  Entries may be stale, so they are
+   checked against the frame table before use. */
+static struct frame *unstable[UNSTABLE_CNT];
+static unsigned unstable_hash[UNSTABLE_CNT];
+static size_t scan_pos;
+
+/* Statistics. */
+static long long pages_shared;  /* Stable pages. */
+static long long pages_sharing; /* User mappings of stable pages. */
+
+static void ksm_daemon(void *aux);
+static unsigned ksm_hash_func(const struct hash_elem *e, void *aux);
+static bool ksm_less_func(const struct hash_elem *a, const struct hash_elem *b,
+                          void *aux);
+static struct frame *hold_next_frame(void);
+static bool hold_if_present(struct frame *f);
+static bool map_shared(struct frame *f, struct ksm_page *kp);
+static void drop_frame(struct frame *f, bool free_page);
+static void merge_frame(struct frame *f);
+
+void ksm_init(void)
+{
+  if (!ksm_enabled)
+    return;
+  hash_init(&stable_pages, ksm_hash_func, ksm_less_func, NULL);
+  lock_init(&ksm_lock);
+  thread_create("ksmd", PRI_DEFAULT, ksm_daemon, NULL);
+}
+
+//give the faulting process a private, writable copy of its shared page
+bool ksm_unshare(struct vm_entry *vme)
+{
+  uint32_t *pd = thread_current()->pagedir;
+  struct ksm_page *kp = vme->ksm;
+  struct frame *f = frame_alloc(PAL_USER);
+
+  if (f == NULL)
+    return false;
+  memcpy(f->faddr, kp->faddr, PGSIZE);
+  pagedir_clear_page(pd, vme->vaddr);
+  if (!pagedir_set_page(pd, vme->vaddr, f->faddr, vme->writable)) {
+    frame_dealloc(f->faddr);
+    return false;
+  }
+  f->vme = vme;
+  vme->ksm = NULL;
+  ksm_put(kp);
+  frame_unpin(f);
+  return true;
+}
+
+//drop one mapping of KP, freeing it with the last one
+void ksm_put(struct ksm_page *kp)
+{
+  lock_acquire(&ksm_lock);
+  pages_sharing--;
+  if (--kp->refcnt == 0) {
+    hash_delete(&stable_pages, &kp->elem);
+    pages_shared--;
+    palloc_free_page(kp->faddr);
+    free(kp);
+  }
+  lock_release(&ksm_lock);
+}
+
+void ksm_print_stats(void)
+{
+  if (ksm_enabled)
+    printf("KSM: %lld pages shared, %lld pages saved\n",
+           pages_shared, pages_sharing - pages_shared);
+}
+
+static void ksm_daemon(void *aux UNUSED)
+{
+  int i;
+
+  for (;;) {
+    timer_sleep(KSM_SLEEP_TICKS);
+    for (i = 0; i < KSM_SCAN_CNT; i++) {
+      struct frame *f = hold_next_frame();
+      if (f != NULL)
+        merge_frame(f);
+    }
+  }
+}
+
+static unsigned ksm_hash_func(const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_entry(e, struct ksm_page, elem)->hash;
+}
+
+//orders by hash, then by contents, so equal means identical pages
+static bool ksm_less_func(const struct hash_elem *a_, const struct hash_elem *b_,
+                          void *aux UNUSED)
+{
+  struct ksm_page *a = hash_entry(a_, struct ksm_page, elem);
+  struct ksm_page *b = hash_entry(b_, struct ksm_page, elem);
+
+  if (a->hash != b->hash)
+    return a->hash < b->hash;
+  return memcmp(a->faddr, b->faddr, PGSIZE) < 0;
+}
+
+//advance the scan by one frame and hold it if it is a candidate
+static struct frame *hold_next_frame(void)
+{
+  struct frame *f = NULL;
+  struct list_elem *e;
+  size_t i;
+
+  lock_acquire(&frame_lock);
+  if (scan_pos >= list_size(&frame_table)) {
+    scan_pos = 0;
+    memset(unstable, 0, sizeof unstable);
+  }
+  for (e = list_begin(&frame_table), i = 0; e != list_end(&frame_table);
+       e = list_next(e), i++)
+    if (i == scan_pos) {
+      f = list_entry(e, struct frame, elem);
+      break;
+    }
+  scan_pos++;
+  if (f != NULL && (f->vme == NULL || f->vme->type != VM_ANON || !frame_hold(f)))
+    f = NULL;
+  lock_release(&frame_lock);
+  return f;
+}
+
+//hold F if it is still in the frame table
+static bool hold_if_present(struct frame *f)
+{
+  struct list_elem *e;
+  bool held = false;
+
+  lock_acquire(&frame_lock);
+  for (e = list_begin(&frame_table); e != list_end(&frame_table); e = list_next(e))
+    if (list_entry(e, struct frame, elem) == f) {
+      held = f->vme != NULL && f->vme->type == VM_ANON && frame_hold(f);
+      break;
+    }
+  lock_release(&frame_lock);
+  return held;
+}
+
+/* Points the user mapping of held frame F at KP's page,
+   read-only, if F is still mapped and holds the same bytes.
+   Interrupts are off while checking and switching, so the owner
+   cannot write in between. */
+static bool map_shared(struct frame *f, struct ksm_page *kp)
+{
+  uint32_t *pd = f->thread->pagedir;
+  struct vm_entry *vme = f->vme;
+  size_t swap_slot = vme->swap_slot;
+  enum intr_level old_level;
+  bool ok = false;
+
+  old_level = intr_disable();
+  if (pagedir_get_page(pd, vme->vaddr) == f->faddr
+      && (f->faddr == kp->faddr || !memcmp(f->faddr, kp->faddr, PGSIZE))) {
+    pagedir_clear_page(pd, vme->vaddr);
+    pagedir_set_page(pd, vme->vaddr, kp->faddr, false);
+    vme->ksm = kp;
+    vme->swap_slot = SWAP_NONE;
+    kp->refcnt++;
+    ok = true;
+  }
+  intr_set_level(old_level);
+
+  if (ok) {
+    swap_free(swap_slot);
+    pages_sharing++;
+  }
+  return ok;
+}
+
+//F was merged: forget the frame, freeing its page unless it became the stable page
+static void drop_frame(struct frame *f, bool free_page)
+{
+  void *faddr = f->faddr;
+
+  lock_acquire(&frame_lock);
+  frame_detach(f);
+  lock_release(&frame_lock);
+  if (free_page)
+    palloc_free_page(faddr);
+}
+
+static void unhold(struct frame *f)
+{
+  lock_acquire(&frame_lock);
+  frame_unhold(f);
+  lock_release(&frame_lock);
+}
+
+//try to merge held frame F with a stable page or a remembered twin
+static void merge_frame(struct frame *f)
+{
+  struct ksm_page key, *kp;
+  struct hash_elem *e;
+  struct frame *g;
+  size_t slot;
+
+  key.faddr = f->faddr;
+  key.hash = hash_bytes(f->faddr, PGSIZE);
+  slot = key.hash % UNSTABLE_CNT;
+
+  lock_acquire(&ksm_lock);
+  e = hash_find(&stable_pages, &key.elem);
+  if (e != NULL) {
+    if (map_shared(f, hash_entry(e, struct ksm_page, elem)))
+      drop_frame(f, true);
+    else
+      unhold(f);
+    lock_release(&ksm_lock);
+    return;
+  }
+
+  g = unstable[slot];
+  if (g == NULL || g == f || unstable_hash[slot] != key.hash || !hold_if_present(g)) {
+    unstable[slot] = f;
+    unstable_hash[slot] = key.hash;
+    unhold(f);
+    lock_release(&ksm_lock);
+    return;
+  }
+  unstable[slot] = NULL;
+
+  //F's page becomes the stable page. it is read-only once mapped, so hash it again then
+  kp = malloc(sizeof *kp);
+  if (kp != NULL) {
+    kp->faddr = f->faddr;
+    kp->refcnt = 0;
+  }
+  if (kp == NULL || !map_shared(f, kp)) {
+    free(kp);
+    unhold(f);
+    unhold(g);
+    lock_release(&ksm_lock);
+    return;
+  }
+  kp->hash = hash_bytes(kp->faddr, PGSIZE);
+  hash_insert(&stable_pages, &kp->elem);
+  pages_shared++;
+  drop_frame(f, false);
+
+  if (map_shared(g, kp))
+    drop_frame(g, true);
+  else
+    unhold(g);
+  lock_release(&ksm_lock);
+}
@@ -0,0 +1,15 @@
+#ifndef VM_KSM_H
+#define VM_KSM_H
+
+#include <stdbool.h>
+#include "vm/page.h"
+
+/* -ksm: Merge identical anonymous pages? */
+extern bool ksm_enabled;
+
+void ksm_init(void);
+bool ksm_unshare(struct vm_entry *vme);
+void ksm_put(struct ksm_page *kp);
+void ksm_print_stats(void);
+
+#endif /* vm/ksm.h */
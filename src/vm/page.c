@@ -1,5 +1,9 @@
 #include "page.h"
 #include "threads/synch.h"
+#include "vm/zswap.h"
+#include "vm/ksm.h"
+
+static bool swap_slot_in_ram(size_t used_index);
 
 
 void vm_init (struct hash *vm) {
@@ -40,7 +44,25 @@ struct vm_entry *vm_find_vme(void *vaddr) {
     return hash_entry(v, struct vm_entry, elem);
 }
 
+//process teardown. the caller has already taken the frames with frame_collect(),
+//and the page directory is destroyed afterwards, so no page is unmapped one by one
 void vm_destroy (struct hash * vm) {
+    struct hash_iterator i;
+
+    //give all swap slots back under a single swap_lock acquisition
+    lock_acquire(&swap_lock);
+    hash_first(&i, vm);
+    while(hash_next(&i)) {
+      struct vm_entry * vme = hash_entry(hash_cur(&i), struct vm_entry, elem);
+      if(vme->swap_slot == SWAP_NONE)
+        continue;
+      if(swap_slot_in_ram(vme->swap_slot))
+        zswap_free(vme->swap_slot - bitmap_size(swap_bitmap));
+      else
+        bitmap_reset(swap_bitmap, vme->swap_slot);
+    }
+    lock_release(&swap_lock);
+
     hash_destroy(vm, vm_destroy_func);
 }
 
@@ -49,11 +71,9 @@ void vm_destroy_func (struct hash_elem * v, void*aux UNUSED) {
   
   if(vme != NULL) 
   {
-    if(vme->is_loaded) {
-        //maybe we should deallcate frame here......
-        frame_dealloc(pagedir_get_page(thread_current()->pagedir, vme->vaddr));
-        pagedir_clear_page(thread_current()->pagedir,vme->vaddr);
-    }
+    //merged pages have no frame, only a reference to the shared page
+    if(vme->is_loaded && vme->ksm != NULL)
+      ksm_put(vme->ksm);
     free(vme);
   }
 }
@@ -84,10 +104,17 @@ void swap_init()
 	swap_bitmap = bitmap_create(block_size(swap_block)*BLOCK_SECTOR_SIZE / PGSIZE);	
   //bitmap_set_all(swap_bitmap, 0);
 	lock_init(&swap_lock);
+  zswap_init();
 }
 
 bool swap_in(size_t used_index, void* kaddr)
 {
+  if (swap_slot_in_ram(used_index)) {
+    zswap_load(used_index - bitmap_size(swap_bitmap), kaddr);
+    zswap_free(used_index - bitmap_size(swap_bitmap));
+    return true;
+  }
+
 	lock_acquire(&swap_lock);
 	int i;
   int sector_num = PGSIZE / BLOCK_SECTOR_SIZE;
@@ -110,6 +137,11 @@ bool swap_in(size_t used_index, void* kaddr)
 
 size_t swap_out(void* kaddr) {
     size_t i = 0;
+
+    //try the compressed swap cache first; it refuses full or incompressible cases
+    size_t ram_slot = zswap_store(kaddr);
+    if (ram_slot != BITMAP_ERROR)
+        return bitmap_size(swap_bitmap) + ram_slot;
     
     lock_acquire(&swap_lock);
     size_t swap_slot = bitmap_scan_and_flip(swap_bitmap, 0, 1, 0);
@@ -126,4 +158,30 @@ size_t swap_out(void* kaddr) {
     //lock_release(&filesys_lock);
     lock_release(&swap_lock);
     return swap_slot;    
-}
\ No newline at end of file
+}
+//write kaddr over swap slot used_index. the page may move, so the new slot is returned
+size_t swap_rewrite(size_t used_index, void* kaddr)
+{
+  swap_free(used_index);
+  return swap_out(kaddr);
+}
+
+//give swap slot used_index back without reading it
+void swap_free(size_t used_index)
+{
+  if (used_index == SWAP_NONE)
+    return;
+  if (swap_slot_in_ram(used_index)) {
+    zswap_free(used_index - bitmap_size(swap_bitmap));
+    return;
+  }
+  lock_acquire(&swap_lock);
+  bitmap_reset(swap_bitmap, used_index);
+  lock_release(&swap_lock);
+}
+
+//slots past the end of the swap disk are entries of the compressed swap cache
+static bool swap_slot_in_ram(size_t used_index)
+{
+  return used_index >= bitmap_size(swap_bitmap);
+}
@@ -20,6 +20,11 @@
 #define VM_ANON 2
 #define CLOSE_ALL 10000
 
+/* swap_slot of a page that has no copy in swap. */
+#define SWAP_NONE BITMAP_ERROR
+
+struct ksm_page;
+
 struct vm_entry {
     uint8_t type;
     void *vaddr;
@@ -38,6 +43,9 @@ struct vm_entry {
 
     /*-------Swapping---------*/
     size_t swap_slot;
+
+    /*-------Same-page merging---------*/
+    struct ksm_page *ksm;     /* Shared read-only page, or NULL. */
 };
 
 
@@ -69,5 +77,7 @@ static struct lock swap_lock;
 void swap_init();
 bool swap_in(size_t used_index, void* kaddr);
 size_t swap_out(void* kaddr);
+size_t swap_rewrite(size_t used_index, void* kaddr);
+void swap_free(size_t used_index);
 
 #endif
\ No newline at end of file
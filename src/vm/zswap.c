@@ -0,0 +1,279 @@
+#include "vm/zswap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Compressed swap cache.
+
+   Evicted pages are compressed with a small LZ77 codec into an
+   arena of kernel-pool pages, carved into CHUNK_SIZE-byte chunks.
+   A page that does not shrink to ZSWAP_MAX_LEN bytes or less, or
+   that finds no room in the arena, is refused and the caller
+   writes it to the swap disk instead.
+
+   Compressed format: a flag byte followed by up to 8 items, one
+   per flag bit, least significant bit first.  A clear bit is a
+   literal byte.  A set bit is a back-reference of two bytes,
+   OOOOOOOO OOOOLLLL, with offset O (1...4095) and length L + 3;
+   when L is 15, one more byte follows that is added to the
+   length. */
+
+#define ARENA_DIV 8                     /* Arena is 1/8 of user pool. */
+#define CHUNK_SIZE 64                   /* Arena allocation unit. */
+#define ZSWAP_MAX_LEN (PGSIZE / 2)      /* Largest page kept in RAM. */
+
+#define MIN_MATCH 3
+#define MAX_OFFSET 4095
+#define MAX_MATCH (MIN_MATCH + 15 + 255)
+#define HASH_BITS 12
+
+/* A compressed page in the arena. */
+struct zswap_entry
+  {
+    uint32_t chunk;                     /* First chunk. */
+    uint16_t len;                       /* Compressed length in bytes. */
+  };
+
+static uint8_t *arena;                  /* Compressed page storage. */
+static struct bitmap *chunk_map;        /* Used chunks of ARENA. */
+static struct zswap_entry *entries;     /* Stored pages. */
+static struct bitmap *entry_map;        /* Used ENTRIES. */
+static struct lock zswap_lock;
+
+/* Compressor state, protected by zswap_lock. */
+static uint16_t hash_table[1 << HASH_BITS];
+static uint8_t scratch[ZSWAP_MAX_LEN];
+
+/* Statistics. */
+static long long store_cnt;             /* Pages stored. */
+static long long store_bytes;           /* Compressed bytes stored. */
+static long long poor_cnt;              /* Refused, compressed poorly. */
+static long long full_cnt;              /* Refused, arena full. */
+
+static size_t lz_compress (const uint8_t *src, uint8_t *dst, size_t dst_max);
+static void lz_decompress (const uint8_t *src, size_t len, uint8_t *dst);
+
+/* Allocates the arena.  If the kernel pool cannot spare it, the
+   cache stays disabled and every page goes to disk. */
+void
+zswap_init (void)
+{
+  size_t page_cnt = palloc_pool_size (PAL_USER) / ARENA_DIV;
+  size_t chunk_cnt;
+
+  lock_init (&zswap_lock);
+  for (; page_cnt > 0; page_cnt /= 2)
+    {
+      arena = palloc_get_multiple (0, page_cnt);
+      if (arena != NULL)
+        break;
+    }
+  if (arena == NULL)
+    return;
+
+  chunk_cnt = page_cnt * PGSIZE / CHUNK_SIZE;
+  chunk_map = bitmap_create (chunk_cnt);
+  entry_map = bitmap_create (chunk_cnt);
+  entries = malloc (chunk_cnt * sizeof *entries);
+  if (chunk_map == NULL || entry_map == NULL || entries == NULL)
+    {
+      bitmap_destroy (chunk_map);
+      bitmap_destroy (entry_map);
+      free (entries);
+      palloc_free_multiple (arena, page_cnt);
+      arena = NULL;
+    }
+}
+
+/* Returns the number of entry indexes zswap_store() may return. */
+size_t
+zswap_slot_cnt (void)
+{
+  return arena != NULL ? bitmap_size (entry_map) : 0;
+}
+
+/* Compresses the page at KADDR into the arena and returns its
+   entry index, or BITMAP_ERROR if the page should go to disk. */
+size_t
+zswap_store (const void *kaddr)
+{
+  size_t len, chunk, slot;
+
+  if (arena == NULL)
+    return BITMAP_ERROR;
+
+  lock_acquire (&zswap_lock);
+  len = lz_compress (kaddr, scratch, sizeof scratch);
+  if (len == 0)
+    {
+      poor_cnt++;
+      lock_release (&zswap_lock);
+      return BITMAP_ERROR;
+    }
+  chunk = bitmap_scan_and_flip (chunk_map, 0, DIV_ROUND_UP (len, CHUNK_SIZE),
+                                false);
+  if (chunk == BITMAP_ERROR)
+    {
+      full_cnt++;
+      lock_release (&zswap_lock);
+      return BITMAP_ERROR;
+    }
+
+  /* There are as many entries as chunks, so this cannot fail. */
+  slot = bitmap_scan_and_flip (entry_map, 0, 1, false);
+  ASSERT (slot != BITMAP_ERROR);
+  entries[slot].chunk = chunk;
+  entries[slot].len = len;
+  memcpy (arena + chunk * CHUNK_SIZE, scratch, len);
+
+  store_cnt++;
+  store_bytes += len;
+  lock_release (&zswap_lock);
+  return slot;
+}
+
+/* Decompresses entry SLOT into the page at KADDR.  The entry
+   stays allocated until zswap_free(). */
+void
+zswap_load (size_t slot, void *kaddr)
+{
+  lock_acquire (&zswap_lock);
+  ASSERT (bitmap_test (entry_map, slot));
+  lz_decompress (arena + entries[slot].chunk * CHUNK_SIZE, entries[slot].len,
+                 kaddr);
+  lock_release (&zswap_lock);
+}
+
+/* Releases entry SLOT and its arena chunks. */
+void
+zswap_free (size_t slot)
+{
+  lock_acquire (&zswap_lock);
+  ASSERT (bitmap_test (entry_map, slot));
+  bitmap_set_multiple (chunk_map, entries[slot].chunk,
+                       DIV_ROUND_UP (entries[slot].len, CHUNK_SIZE), false);
+  bitmap_reset (entry_map, slot);
+  lock_release (&zswap_lock);
+}
+
+/* Prints compressed swap statistics. */
+void
+zswap_print_stats (void)
+{
+  printf ("Zswap: %lld pages stored in %lld bytes, "
+          "%lld incompressible, %lld refused when full\n",
+          store_cnt, store_bytes, poor_cnt, full_cnt);
+}
+
+/* Hashes the MIN_MATCH bytes at P. */
+static inline unsigned
+hash3 (const uint8_t *p)
+{
+  uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+  return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Compresses the PGSIZE bytes at SRC into DST, which has room
+   for DST_MAX bytes.  Returns the compressed length, or 0 if it
+   would exceed DST_MAX. */
+static size_t
+lz_compress (const uint8_t *src, uint8_t *dst, size_t dst_max)
+{
+  size_t ip = 0, op = 0, flag_ofs = 0;
+  int item = 0;
+
+  memset (hash_table, 0, sizeof hash_table);
+  while (ip < PGSIZE)
+    {
+      size_t cand, len;
+      unsigned h;
+
+      if (item % 8 == 0)
+        {
+          if (op >= dst_max)
+            return 0;
+          flag_ofs = op;
+          dst[op++] = 0;
+        }
+      if (op + 3 > dst_max)
+        return 0;
+      item++;
+
+      if (ip + MIN_MATCH <= PGSIZE)
+        {
+          /* HASH_TABLE holds positions plus 1, so 0 means none. */
+          h = hash3 (src + ip);
+          cand = hash_table[h];
+          hash_table[h] = ip + 1;
+          if (cand != 0 && ip + 1 - cand <= MAX_OFFSET
+              && !memcmp (src + cand - 1, src + ip, MIN_MATCH))
+            {
+              size_t ofs = ip + 1 - cand;
+
+              cand--;
+              for (len = MIN_MATCH; ip + len < PGSIZE && len < MAX_MATCH
+                     && src[cand + len] == src[ip + len]; len++)
+                continue;
+
+              dst[flag_ofs] |= 1 << ((item - 1) % 8);
+              dst[op++] = ofs >> 4;
+              if (len - MIN_MATCH < 15)
+                dst[op++] = (ofs << 4) | (len - MIN_MATCH);
+              else
+                {
+                  dst[op++] = (ofs << 4) | 15;
+                  dst[op++] = len - MIN_MATCH - 15;
+                }
+              ip += len;
+              continue;
+            }
+        }
+      dst[op++] = src[ip++];
+    }
+  return op;
+}
+
+/* Decompresses the LEN bytes at SRC, produced by lz_compress(),
+   into the page at DST. */
+static void
+lz_decompress (const uint8_t *src, size_t len, uint8_t *dst)
+{
+  const uint8_t *end = src + len;
+  size_t op = 0;
+  int flags = 0, item = 0;
+
+  while (src < end)
+    {
+      if (item++ % 8 == 0)
+        flags = *src++;
+      if (flags & 1)
+        {
+          size_t ofs = (src[0] << 4) | (src[1] >> 4);
+          size_t cnt = (src[1] & 15) + MIN_MATCH;
+          if ((src[1] & 15) == 15)
+            {
+              cnt += src[2];
+              src++;
+            }
+          src += 2;
+
+          ASSERT (ofs != 0 && ofs <= op && op + cnt <= PGSIZE);
+          for (; cnt > 0; cnt--, op++)
+            dst[op] = dst[op - ofs];
+        }
+      else
+        {
+          ASSERT (op < PGSIZE);
+          dst[op++] = *src++;
+        }
+      flags >>= 1;
+    }
+  ASSERT (op == PGSIZE);
+}
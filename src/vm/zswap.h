@@ -0,0 +1,17 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Compressed in-memory swap tier that sits in front of the swap
+   disk.  Entries are identified by indexes in [0, zswap_slot_cnt()). */
+
+void zswap_init(void);
+size_t zswap_slot_cnt(void);
+size_t zswap_store(const void *kaddr);
+void zswap_load(size_t slot, void *kaddr);
+void zswap_free(size_t slot);
+void zswap_print_stats(void);
+
+#endif /* vm/zswap.h */